@@ -25,6 +25,22 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * \brief Set to 1 to build for CAN FD controllers, with up to 64 data bytes per frame
+ */
+#ifndef DIYPINBALL_CAN_FD
+#define DIYPINBALL_CAN_FD 0
+#endif
+
+/*
+ * \brief Maximum number of data bytes in a frame
+ */
+#if DIYPINBALL_CAN_FD
+#define DIYPINBALL_MAX_DATA_LENGTH 64
+#else
+#define DIYPINBALL_MAX_DATA_LENGTH 8
+#endif
+
 /*
  * \struct diypinball_canMessage
  * \brief Stores an entire CAN message to be sent or having been received
@@ -32,10 +48,46 @@ extern "C" {
 typedef struct diypinball_canMessage {
     uint32_t id;                                /**< CAN packet arbitration field */
     uint8_t rtr;                                /**< Remote transfer request flag */
-    uint8_t dlc;                                /**< Data length */
-    uint8_t data[8];                            /**< Packet data */
+    uint8_t dlc;                                /**< Data length code - the byte count up to 8, CAN FD codes 9-15 above that */
+    uint8_t data[DIYPINBALL_MAX_DATA_LENGTH];   /**< Packet data */
 } diypinball_canMessage_t;
 
+/*
+ * \brief Convert a data length code to the number of data bytes it stands for
+ */
+static inline uint8_t diypinball_dlcToLength(uint8_t dlc) {
+#if DIYPINBALL_CAN_FD
+    static const uint8_t fdLengths[7] = {12, 16, 20, 24, 32, 48, 64};
+
+    if(dlc > 8) {
+        return fdLengths[(dlc > 15 ? 15 : dlc) - 9];
+    }
+#else
+    if(dlc > 8) {
+        return 8;
+    }
+#endif
+    return dlc;
+}
+
+/*
+ * \brief Convert a number of data bytes to the smallest data length code that holds them
+ */
+static inline uint8_t diypinball_lengthToDlc(uint8_t length) {
+#if DIYPINBALL_CAN_FD
+    if(length <= 8) return length;
+    if(length <= 12) return 9;
+    if(length <= 16) return 10;
+    if(length <= 20) return 11;
+    if(length <= 24) return 12;
+    if(length <= 32) return 13;
+    if(length <= 48) return 14;
+    return 15;
+#else
+    return (length > 8) ? 8 : length;
+#endif
+}
+
 /*
  * \brief Pinball message type
  */
@@ -58,16 +110,66 @@ typedef struct diypinball_pinballMessage {
     uint8_t function;                           /**< Function, 0-15 */
     uint8_t reserved;                           /**< Reserved, 0-15 */
     diypinball_pinballMessageType_t messageType;/**< Message type */
-    uint8_t dataLength;                         /**< Data length */
-    uint8_t data[8];                            /**< Packet data */
+    uint8_t dataLength;                         /**< Data length in bytes */
+    uint8_t data[DIYPINBALL_MAX_DATA_LENGTH];   /**< Packet data */
 } diypinball_pinballMessage_t;
 
+/*
+ * \struct diypinball_pinballMessageView
+ * \brief Read-only view of a received CAN message as a pinball packet. Fields are extracted on demand by the
+ * diypinball_pinballMessageView_get* accessors instead of being decoded up front.
+ */
+typedef struct diypinball_pinballMessageView {
+    const diypinball_canMessage_t *message;     /**< The received CAN message */
+} diypinball_pinballMessageView_t;
+
+static inline uint8_t diypinball_pinballMessageView_getPriority(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x1E000000) >> 25;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getUnitSpecific(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x01000000) >> 24;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getBoardAddress(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x00FF0000) >> 16;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getFeatureType(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x0000F000) >> 12;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getFeatureNum(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x00000F00) >> 8;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getFunction(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x000000F0) >> 4;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getReserved(const diypinball_pinballMessageView_t *view) {
+    return (view->message->id & 0x0000000F);
+}
+
+static inline diypinball_pinballMessageType_t diypinball_pinballMessageView_getMessageType(const diypinball_pinballMessageView_t *view) {
+    return view->message->rtr ? MESSAGE_REQUEST : MESSAGE_COMMAND;
+}
+
+static inline uint8_t diypinball_pinballMessageView_getDataLength(const diypinball_pinballMessageView_t *view) {
+    return diypinball_dlcToLength(view->message->dlc);
+}
+
+static inline const uint8_t* diypinball_pinballMessageView_getData(const diypinball_pinballMessageView_t *view) {
+    return view->message->data;
+}
+
 /*
  * \brief Pinball function result
  */
 typedef enum diypinball_result {
     RESULT_SUCCESS,                             /**< Function succeeded */
-    RESULT_FAIL_INVALID_PARAMETER               /**< Failed - Provided parameter was invalid */
+    RESULT_FAIL_INVALID_PARAMETER,              /**< Failed - Provided parameter was invalid */
+    RESULT_FAIL_QUEUE_FULL                      /**< Failed - Queue has no free slots */
 } diypinball_result_t;
 
 /*
@@ -75,6 +177,12 @@ typedef enum diypinball_result {
  */
 typedef void (*diypinball_canMessageSendHandler)(diypinball_canMessage_t *message);
 
+/*
+ * \brief Function pointer to a batched message send handler, optionally implemented by the user for a given platform
+ * to load several messages into the controller's transmit mailboxes at once
+ */
+typedef void (*diypinball_canMessageSendBatchHandler)(diypinball_canMessage_t *messages, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -73,9 +73,9 @@ void diypinball_bootloaderControlFeatureHandler_init(diypinball_bootloaderContro
  * \param[in] instance                  BootloaderControlFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_bootloaderControlFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_bootloaderControlFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a BootloaderControlFeatureHandler instance
@@ -123,9 +123,9 @@ void diypinball_bootloaderFeatureHandler_init(diypinball_bootloaderFeatureHandle
  * \param[in] instance                  BootloaderFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_bootloaderFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_bootloaderFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a BootloaderFeatureHandler instance
@@ -80,9 +80,9 @@ void diypinball_coilFeatureHandler_init(diypinball_coilFeatureHandlerInstance_t
  * \param[in] instance                  CoilFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_coilFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_coilFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a CoilFeatureHandler instance
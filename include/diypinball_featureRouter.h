@@ -26,19 +26,229 @@ extern "C" {
 
 #include <stdint.h>
 
+/*
+ * \brief Number of slots in the FeatureRouter receive queue, must be a power of two
+ */
+#ifndef DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE
+#define DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE 8
+#endif
+
+#if (DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE & (DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE - 1)) || (DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE > 128)
+#error "DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
+/*
+ * \brief Maximum number of slots in the FeatureRouter transmit queue
+ */
+#ifndef DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE
+#define DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE 8
+#endif
+
+#if (DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE < 1) || (DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE > 255)
+#error "DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE must be between 1 and 255"
+#endif
+
+/*
+ * \brief Maximum number of messages gathered for a single call to the batched CAN send handler
+ */
+#ifndef DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE
+#define DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE 8
+#endif
+
+#if (DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE < 1) || (DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE > 255)
+#error "DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE must be between 1 and 255"
+#endif
+
+/*
+ * \brief Set to 1 to keep per-feature traffic and dispatch timing statistics in the FeatureRouter
+ */
+#ifndef DIYPINBALL_FEATUREROUTER_STATISTICS
+#define DIYPINBALL_FEATUREROUTER_STATISTICS 0
+#endif
+
+/*
+ * \brief Size of the segmented transfer buffers, the largest payload that can be sent or received as a
+ * sequence of frames. 0 disables segmented transfers.
+ */
+#ifndef DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+#define DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE 0
+#endif
+
+#if (DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE != 0) && ((DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE <= DIYPINBALL_MAX_DATA_LENGTH) || (DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE > 4095))
+#error "DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE must be 0, or larger than one frame and no more than 4095"
+#endif
+
+/*
+ * \brief Ticks a segmented transfer may wait for its next frame before it is abandoned
+ */
+#ifndef DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT
+#define DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT 1000
+#endif
+
+/*
+ * \brief Reserved field values marking the frames of a segmented transfer
+ */
+#define DIYPINBALL_SEGMENT_FIRST_FRAME 0x08             /**< data[0-1] total length, then the first bytes of the payload, filling the frame */
+#define DIYPINBALL_SEGMENT_CONSECUTIVE_FRAME 0x09       /**< data[0] sequence number, then up to a frame's worth of payload */
+#define DIYPINBALL_SEGMENT_FLOW_CONTROL 0x0A            /**< data[0] flow status, data[1] block size, data[2] separation time in ticks */
+
+/*
+ * \brief Flow status values carried in a segmented transfer flow control frame
+ */
+#define DIYPINBALL_SEGMENT_FLOW_CONTINUE 0x00           /**< Send the next block */
+#define DIYPINBALL_SEGMENT_FLOW_WAIT 0x01               /**< Receiver is busy, wait for another flow control frame */
+#define DIYPINBALL_SEGMENT_FLOW_OVERFLOW 0x02           /**< Transfer is too large for the receiver, abandon it */
+
+/*
+ * \brief Broadcast (non-unit-specific) frames use the board address field as a group address - 0 reaches every
+ * board, 1 to DIYPINBALL_FEATUREROUTER_GROUP_COUNT reach the boards that joined that group, the rest are ignored
+ */
+#define DIYPINBALL_BROADCAST_ALL_BOARDS 0x00
+#define DIYPINBALL_FEATUREROUTER_GROUP_COUNT 32
+
+/*
+ * \brief Returned by a millisecond tick handler that has no pending work
+ */
+#define DIYPINBALL_TICK_NONE 0xFFFFFFFF
+
 typedef struct diypinball_featureRouterInstance diypinball_featureRouterInstance_t;
 typedef struct diypinball_featureRouterInit diypinball_featureRouterInit_t;
 typedef struct diypinball_featureHandlerInstance diypinball_featureHandlerInstance_t;
 
+/*
+ * \struct diypinball_canFilter
+ * \brief A CAN controller acceptance filter - a message is accepted when (id & mask) == (filter id & mask)
+ */
+typedef struct diypinball_canFilter {
+    uint32_t id;                                        /**< Arbitration field bits to match */
+    uint32_t mask;                                      /**< Arbitration field bits that are compared */
+} diypinball_canFilter_t;
+
 /*
  * \brief Function pointer to a message received handler, implemented by a FeatureHandler
  */
 typedef void (*diypinball_messageReceivedHandler)(void *featureHandlerInstance, diypinball_pinballMessage_t *message);
 
 /*
- * \brief Function pointer to a millisecond tick handler, implemented by a FeatureHandler
+ * \brief Function pointer to a message view received handler, optionally implemented by a FeatureHandler in place of a message received handler
+ */
+typedef void (*diypinball_messageViewReceivedHandler)(void *featureHandlerInstance, const diypinball_pinballMessageView_t *view);
+
+/*
+ * \brief Function pointer to a buffer received handler, optionally implemented by a FeatureHandler to accept
+ * segmented transfers. The header carries the routing fields of the transfer; its data is unused.
+ */
+typedef void (*diypinball_bufferReceivedHandler)(void *featureHandlerInstance, diypinball_pinballMessage_t *header, const uint8_t *buffer, uint16_t length);
+
+/*
+ * \brief Function pointer to a millisecond tick handler, implemented by a FeatureHandler. Returns the number of
+ * ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE if it has no scheduled work.
+ */
+typedef uint32_t (*diypinball_millisecondTickHandler)(void *featureHandlerInstance, uint32_t tickNum);
+
+/*
+ * \brief Function pointer to a free-running millisecond counter read handler, whose implementation is
+ * platform-specific. Must count in the same ticks passed to diypinball_featureRouter_millisecondTick.
+ */
+typedef uint32_t (*diypinball_featureRouterTickSourceHandler)(void);
+
+/*
+ * \brief Function pointer to a transmit queue lock or unlock handler, whose implementation is platform-specific.
+ * Typically masks and unmasks the CAN transmit complete interrupt.
+ */
+typedef void (*diypinball_featureRouterTxQueueLockHandler)(void);
+
+/*
+ * \struct diypinball_featureRouterRxQueue
+ * \brief Single-producer, single-consumer ring of received CAN messages awaiting dispatch
+ */
+typedef struct diypinball_featureRouterRxQueue {
+    diypinball_canMessage_t messages[DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE];  /**< Queued messages */
+    volatile uint8_t head;                              /**< Free-running write index, only modified by the producer */
+    volatile uint8_t tail;                              /**< Free-running read index, only modified by the consumer */
+    uint8_t highWaterMark;                              /**< Highest number of messages ever waiting in the queue */
+    uint32_t overflowCount;                             /**< Number of messages dropped because the queue was full */
+} diypinball_featureRouterRxQueue_t;
+
+/*
+ * \struct diypinball_featureRouterTxBatch
+ * \brief Outgoing CAN messages gathered while a batch is open, passed to the batched CAN send handler together
+ */
+typedef struct diypinball_featureRouterTxBatch {
+    diypinball_canMessage_t messages[DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE];  /**< Gathered messages, in send order */
+    uint8_t count;                                      /**< Number of messages gathered */
+    uint8_t openCount;                                  /**< Nesting depth of open batches, messages are gathered while non-zero */
+} diypinball_featureRouterTxBatch_t;
+
+/*
+ * \struct diypinball_featureRouterTxQueue
+ * \brief Outgoing CAN messages, kept sorted so the lowest arbitration ID is sent first
+ */
+typedef struct diypinball_featureRouterTxQueue {
+    diypinball_canMessage_t messages[DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE];  /**< Queued messages, highest arbitration ID first */
+    uint8_t depth;                                      /**< Configured depth, 0 when the queue is disabled */
+    uint8_t count;                                      /**< Number of messages currently queued */
+    uint8_t peakCount;                                  /**< Highest number of messages ever queued */
+    uint32_t dropCount;                                 /**< Number of messages dropped because the queue was full */
+    diypinball_featureRouterTxQueueLockHandler lockHandler;     /**< Pointer to the function that keeps transmitNext out of the queue, NULL if not needed */
+    diypinball_featureRouterTxQueueLockHandler unlockHandler;   /**< Pointer to the function that lets transmitNext back in, NULL if not needed */
+} diypinball_featureRouterTxQueue_t;
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+/*
+ * \struct diypinball_featureRouterSegmentRx
+ * \brief Reassembly state for an incoming segmented transfer
+ */
+typedef struct diypinball_featureRouterSegmentRx {
+    uint32_t id;                                        /**< Arbitration ID of the first frame, reserved field cleared */
+    uint16_t length;                                    /**< Total length of the transfer, 0 when idle */
+    uint16_t received;                                  /**< Bytes received so far */
+    uint8_t sequence;                                   /**< Sequence number expected in the next consecutive frame */
+    uint8_t blockRemaining;                             /**< Consecutive frames left before the next flow control frame, 0 for no limit */
+    uint8_t blockSize;                                  /**< Block size advertised in flow control frames, 0 for no limit */
+    uint8_t separationTime;                             /**< Minimum ticks between consecutive frames advertised in flow control frames */
+    uint32_t lastTick;                                  /**< Tick of the most recent frame, for the timeout */
+    uint8_t buffer[DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE];  /**< Reassembled payload */
+} diypinball_featureRouterSegmentRx_t;
+
+/*
+ * \struct diypinball_featureRouterSegmentTx
+ * \brief Transmit state for an outgoing segmented transfer
+ */
+typedef struct diypinball_featureRouterSegmentTx {
+    uint32_t id;                                        /**< Arbitration ID of the transfer, reserved field cleared */
+    uint16_t length;                                    /**< Total length of the transfer, 0 when idle */
+    uint16_t sent;                                      /**< Bytes sent so far */
+    uint8_t sequence;                                   /**< Sequence number of the next consecutive frame */
+    uint8_t waiting;                                    /**< Non-zero while waiting for a flow control frame */
+    uint8_t blockRemaining;                             /**< Consecutive frames left in the current block, 0 for no limit */
+    uint8_t separationTime;                             /**< Minimum ticks between consecutive frames requested by the receiver */
+    uint32_t lastTick;                                  /**< Tick of the most recent frame sent or flow control received */
+    uint8_t buffer[DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE];  /**< Payload being sent */
+} diypinball_featureRouterSegmentTx_t;
+#endif
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+/*
+ * \brief Function pointer to a free-running cycle counter read handler, whose implementation is platform-specific
  */
-typedef void (*diypinball_millisecondTickHandler)(void *featureHandlerInstance, uint32_t tickNum);
+typedef uint32_t (*diypinball_featureRouterCycleCounterHandler)(void);
+
+/*
+ * \struct diypinball_featureStatistics
+ * \brief Traffic and dispatch timing counters for a single feature type
+ */
+typedef struct diypinball_featureStatistics {
+    uint32_t rxCount;                                   /**< Messages routed to the FeatureHandler */
+    uint32_t txCount;                                   /**< Messages sent with this feature type */
+    uint32_t dropCount;                                 /**< Messages dropped - no FeatureHandler, or transmit queue full */
+    uint32_t unknownFunctionCount;                      /**< Messages for a function the FeatureHandler doesn't implement */
+    uint32_t handlerCallCount;                          /**< Number of timed message handler calls */
+    uint32_t handlerCyclesMin;                          /**< Shortest message handler call, in cycles */
+    uint32_t handlerCyclesMax;                          /**< Longest message handler call, in cycles */
+    uint64_t handlerCyclesTotal;                        /**< Total cycles spent in the message handler */
+} diypinball_featureStatistics_t;
+#endif
 
 /*
  * \struct diypinball_featureRouterInstance
@@ -47,7 +257,27 @@ typedef void (*diypinball_millisecondTickHandler)(void *featureHandlerInstance,
 struct diypinball_featureRouterInstance {
     uint8_t boardAddress;                               /**< The board address for this FeatureRouter */
     diypinball_featureHandlerInstance_t* features[16];  /**< Array of pointers to the implemented FeatureHandlers */
+    diypinball_messageViewReceivedHandler viewHandlers[16];     /**< MessageViewReceivedHandler of each FeatureHandler, used instead of its messageHandler when not NULL */
     diypinball_canMessageSendHandler canSendHandler;    /**< Pointer to the function to send a CAN message */
+    diypinball_canMessageSendBatchHandler canSendBatchHandler;  /**< Pointer to the function to send several CAN messages at once, NULL if not implemented */
+    diypinball_featureRouterTxBatch_t txBatch;          /**< Messages gathered for canSendBatchHandler */
+    uint32_t groupMask;                                 /**< Broadcast groups this board belongs to, bit 0 for group 1 */
+    diypinball_featureRouterRxQueue_t rxQueue;          /**< Receive queue filled by diypinball_featureRouter_enqueueCAN */
+    diypinball_featureRouterTxQueue_t txQueue;          /**< Optional transmit queue drained by diypinball_featureRouter_transmitNext */
+    uint32_t currentTick;                               /**< Most recent tick passed to diypinball_featureRouter_millisecondTick or read from tickSourceHandler */
+    diypinball_featureRouterTickSourceHandler tickSourceHandler;    /**< Pointer to the platform millisecond counter, NULL to use the last tick passed in */
+    uint32_t tickDeadlines[16];                         /**< Tick at which each FeatureHandler's tick handler is next due */
+    uint16_t tickPendingMask;                           /**< Bitmap of FeatureHandlers with a tick deadline set */
+    uint32_t nextTickDeadline;                          /**< Earliest deadline in tickDeadlines, valid when tickPendingMask is non-zero */
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    diypinball_bufferReceivedHandler bufferHandlers[16];        /**< BufferReceivedHandler of each FeatureHandler, NULL if it doesn't accept segmented transfers */
+    diypinball_featureRouterSegmentRx_t segmentRx;      /**< Incoming segmented transfer */
+    diypinball_featureRouterSegmentTx_t segmentTx;      /**< Outgoing segmented transfer */
+#endif
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    diypinball_featureStatistics_t statistics[16];      /**< Per-feature-type statistics */
+    diypinball_featureRouterCycleCounterHandler cycleCounterHandler;    /**< Pointer to the cycle counter used to time message handlers, NULL to disable timing */
+#endif
 };
 
 /*
@@ -101,7 +331,20 @@ void diypinball_featureRouter_deinit(diypinball_featureRouterInstance_t* feature
 diypinball_result_t diypinball_featureRouter_addFeature(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_featureHandlerInstance_t* featureHandlerInstance);
 
 /**
- * \brief Process a received CAN message, and route it to the proper FeatureHandler
+ * \brief Route a feature's messages to a MessageViewReceivedHandler instead of its messageHandler, so they are
+ * not decoded first. Adding the feature again clears it.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] featureType               Feature type of a FeatureHandler already added
+ * \param[in] viewHandler               Pointer to the MessageViewReceivedHandler, NULL to go back to the messageHandler
+ *
+ * \return RESULT_SUCCESS on success, RESULT_FAIL_INVALID_PARAMETER if no FeatureHandler has the featureType
+ */
+diypinball_result_t diypinball_featureRouter_setViewHandler(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t featureType, diypinball_messageViewReceivedHandler viewHandler);
+
+/**
+ * \brief Process a received CAN message, and route it to the proper FeatureHandler. Unit-specific messages
+ * addressed to other boards, and broadcast messages for groups this board hasn't joined, are discarded.
  *
  * \param[in] featureRouterInstance     FeatureRouter instance struct
  * \param[in] message                   CAN message struct
@@ -110,6 +353,155 @@ diypinball_result_t diypinball_featureRouter_addFeature(diypinball_featureRouter
  */
 void diypinball_featureRouter_receiveCAN(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessage_t* message);
 
+/**
+ * \brief Queue a received CAN message for later dispatch. Safe to call from the CAN receive interrupt,
+ * provided it is the only producer and diypinball_featureRouter_processPending is the only consumer.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] message                   CAN message struct, copied into the queue
+ *
+ * \return RESULT_SUCCESS on success, RESULT_FAIL_QUEUE_FULL if the message was dropped
+ */
+diypinball_result_t diypinball_featureRouter_enqueueCAN(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessage_t* message);
+
+/**
+ * \brief Dispatch all CAN messages queued by diypinball_featureRouter_enqueueCAN. Call from the main loop.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Number of messages dispatched
+ */
+uint8_t diypinball_featureRouter_processPending(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Get the receive queue statistics
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[out] highWaterMark            Highest number of messages ever waiting in the queue
+ * \param[out] overflowCount            Number of messages dropped because the queue was full
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_getRxQueueStatistics(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t *highWaterMark, uint32_t *overflowCount);
+
+/**
+ * \brief Set the depth of the transmit queue. While the depth is non-zero, sendPinballMessage queues messages
+ * instead of calling the CAN send handler, and the HAL drains them with diypinball_featureRouter_transmitNext.
+ * Any messages still queued are discarded and counted as drops.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] depth                     Queue depth, 0 to send messages directly
+ *
+ * \return RESULT_SUCCESS on success, RESULT_FAIL_INVALID_PARAMETER if the depth exceeds DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE
+ */
+diypinball_result_t diypinball_featureRouter_setTxQueueDepth(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t depth);
+
+/**
+ * \brief Pass the queued message with the lowest arbitration ID to the CAN send handler. Call from the CAN
+ * transmit complete interrupt and whenever a transmit mailbox is idle. Unless lock handlers are set with
+ * diypinball_featureRouter_setTxQueueLockHandlers, must not preempt, or be preempted by, code that sends
+ * PinballMessages through the same FeatureRouter.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Number of messages sent (0 or 1)
+ */
+uint8_t diypinball_featureRouter_transmitNext(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Set the functions that guard the transmit queue, so diypinball_featureRouter_transmitNext can run from
+ * an interrupt that preempts code sending PinballMessages. The lock is held while the queue is changed and while
+ * the message taken from it is passed to the CAN send handler.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] lockHandler               Pointer to the lock function, NULL if not needed
+ * \param[in] unlockHandler             Pointer to the unlock function, NULL if not needed
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_setTxQueueLockHandlers(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_featureRouterTxQueueLockHandler lockHandler, diypinball_featureRouterTxQueueLockHandler unlockHandler);
+
+/**
+ * \brief Set the function that sends several CAN messages at once, for controllers with more than one transmit
+ * mailbox. Without it, or outside a batch, messages go to the CAN send handler one at a time.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] canSendBatchHandler       Pointer to the batch send function, NULL if not implemented
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_setCanSendBatchHandler(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessageSendBatchHandler canSendBatchHandler);
+
+/**
+ * \brief Get the number of messages that can be sent before the transmit queue is full, so a feature sending
+ * a run of messages can spread them over several ticks instead of having them dropped
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Free transmit queue slots, or 0xFF while the depth is 0 and messages go straight to the CAN send handler
+ */
+uint8_t diypinball_featureRouter_getTxQueueSpace(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Get the transmit queue statistics
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[out] peakCount                Highest number of messages ever queued
+ * \param[out] dropCount                Number of messages dropped because the queue was full
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_getTxQueueStatistics(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t *peakCount, uint32_t *dropCount);
+
+/**
+ * \brief Set the broadcast groups this board belongs to
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] groupMask                 Group bitmap, bit 0 for group 1
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_setGroupMask(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t groupMask);
+
+/**
+ * \brief Get the broadcast groups this board belongs to
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Group bitmap, bit 0 for group 1
+ */
+uint32_t diypinball_featureRouter_getGroupMask(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Open a transmit batch. Until the matching diypinball_featureRouter_endBatch, messages that would go
+ * straight to the CAN send handler are gathered and passed to the batched CAN send handler together. Message
+ * dispatch and millisecond ticks open a batch of their own. Does nothing without a batched CAN send handler.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_beginBatch(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Close a transmit batch, sending the gathered messages once the outermost batch is closed
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_endBatch(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Fully decode a message view into a PinballMessage
+ *
+ * \param[in] view                      Message view struct
+ * \param[out] message                  PinballMessage struct to fill
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_decodeMessageView(const diypinball_pinballMessageView_t *view, diypinball_pinballMessage_t *message);
+
 /**
  * \brief Get a bitmap of features that have been implemented
  *
@@ -121,14 +513,77 @@ void diypinball_featureRouter_receiveCAN(diypinball_featureRouterInstance_t* fea
 void diypinball_featureRouter_getFeatureBitmap(diypinball_featureRouterInstance_t* featureRouterInstance, uint16_t *bitmap);
 
 /**
- * \brief Distribute a millisecondTick event to all implemented features
+ * \brief Compute a set of acceptance filters that pass only messages for this board's implemented features:
+ * unit-specific messages addressed to this board and broadcast messages. Broadcast group membership is left to
+ * diypinball_featureRouter_receiveCAN, so joining a group doesn't require the filters to be reloaded. Feature types are merged into aligned
+ * blocks to keep the count down. If more than maxFilters would be needed, the filters fall back to matching on
+ * the board address alone, and with fewer than two slots a single accept-all filter is produced.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[out] filters                  Array to receive the filters
+ * \param[in] maxFilters                Number of entries available in filters
+ *
+ * \return Number of filters written
+ */
+uint8_t diypinball_featureRouter_getAcceptanceFilters(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canFilter_t *filters, uint8_t maxFilters);
+
+/**
+ * \brief Distribute a millisecondTick event to the features whose tick deadline has passed. Features are due
+ * immediately after being added and after each message routed to them; after that, each feature's tick handler
+ * decides when it next needs to run.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] tickNum                   Current timer tick
+ *
+ * \return Number of ticks until a feature next needs to run, or DIYPINBALL_TICK_NONE
+ */
+uint32_t diypinball_featureRouter_millisecondTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum);
+
+/**
+ * \brief Get the number of ticks until a feature next needs to run. Call after dispatching received messages,
+ * which can bring a deadline forward, to decide how long the main loop may sleep.
  *
  * \param[in] featureRouterInstance     FeatureRouter instance struct
  * \param[in] tickNum                   Current timer tick
  *
+ * \return Number of ticks until the earliest deadline (0 if already due), or DIYPINBALL_TICK_NONE
+ */
+uint32_t diypinball_featureRouter_getTicksUntilDeadline(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum);
+
+/**
+ * \brief Request that a feature's tick handler runs within the given number of ticks. Used by FeatureHandlers
+ * when a change made outside the tick handler creates new timed work.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] featureType               Feature type of the FeatureHandler
+ * \param[in] delay                     Number of ticks from the current tick
+ *
  * \return Nothing
  */
-void diypinball_featureRouter_millisecondTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum);
+void diypinball_featureRouter_scheduleTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t featureType, uint32_t delay);
+
+/**
+ * \brief Get the current tick. Without a tick source this is the most recent tick passed to
+ * diypinball_featureRouter_millisecondTick, which lags real time while the main loop sleeps until the next
+ * deadline, so events timed against it (switch rule cooldowns, statistics, chatter and stuck detection) should
+ * then only be registered after the tick that covers them has been passed in.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Current timer tick
+ */
+uint32_t diypinball_featureRouter_getTick(diypinball_featureRouterInstance_t* featureRouterInstance);
+
+/**
+ * \brief Set the platform millisecond counter the FeatureRouter reads the current tick from, so that events
+ * registered between two calls to diypinball_featureRouter_millisecondTick are timed correctly
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] tickSourceHandler         Pointer to the millisecond counter read function, NULL to use the last tick passed in
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_setTickSourceHandler(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_featureRouterTickSourceHandler tickSourceHandler);
 
 /**
  * \brief Send a PinballMessage from a FeatureHandler to the CAN Send handler
@@ -140,6 +595,116 @@ void diypinball_featureRouter_millisecondTick(diypinball_featureRouterInstance_t
  */
 void diypinball_featureRouter_sendPinballMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *message);
 
+/**
+ * \brief Encode a PinballMessage into the CAN frame that sendPinballMessage would send. Lets a FeatureHandler
+ * build a frame that never changes once and send it repeatedly with sendCANMessage
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] message                   pinballMessage struct to be encoded
+ * \param[out] encodedMessage           CAN message struct to hold the encoded frame
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_encodePinballMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *message, diypinball_canMessage_t *encodedMessage);
+
+/**
+ * \brief Send an already encoded CAN frame from a FeatureHandler, through the same queueing and batching as
+ * sendPinballMessage
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] message                   CAN message struct to be sent
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_sendCANMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message);
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+/**
+ * \brief Send a buffer from a FeatureHandler. Buffers that fit in one frame go out as a single PinballMessage; longer
+ * ones are sent as a segmented transfer - a first frame, then consecutive frames paced by the receiver's flow
+ * control frames, driven from diypinball_featureRouter_receiveCAN and diypinball_featureRouter_millisecondTick.
+ * Only one segmented transfer can be in progress at a time. With the transmit queue enabled, consecutive frames are only
+ * queued while it has a free slot, the rest wait for the next tick, and the transfer is abandoned if a more urgent
+ * message evicts one of its frames.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] header                    pinballMessage struct with the routing fields, its data is ignored
+ * \param[in] buffer                    Payload, copied before returning
+ * \param[in] length                    Payload length in bytes
+ *
+ * \return RESULT_SUCCESS on success, RESULT_FAIL_INVALID_PARAMETER if the header is a request or the length
+ * exceeds DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE, RESULT_FAIL_QUEUE_FULL if a segmented transfer is already in progress or the transmit queue is full
+ */
+diypinball_result_t diypinball_featureRouter_sendPinballBuffer(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *header, const uint8_t *buffer, uint16_t length);
+
+/**
+ * \brief Set the flow control parameters sent to the other end of incoming segmented transfers
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] blockSize                 Consecutive frames to receive between flow control frames, 0 for no limit
+ * \param[in] separationTime            Minimum ticks between consecutive frames
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_setSegmentFlowControl(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t blockSize, uint8_t separationTime);
+
+/**
+ * \brief Accept segmented transfers for a feature, passing each reassembled payload to a BufferReceivedHandler.
+ * Adding the feature again clears it.
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] featureType               Feature type of a FeatureHandler already added
+ * \param[in] bufferHandler             Pointer to the BufferReceivedHandler, NULL to refuse segmented transfers
+ *
+ * \return RESULT_SUCCESS on success, RESULT_FAIL_INVALID_PARAMETER if no FeatureHandler has the featureType
+ */
+diypinball_result_t diypinball_featureRouter_setBufferHandler(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType, diypinball_bufferReceivedHandler bufferHandler);
+#endif
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+/**
+ * \brief Set the cycle counter used to time message handler calls
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] cycleCounterHandler       Pointer to the cycle counter read function, NULL to disable timing
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_setCycleCounterHandler(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_featureRouterCycleCounterHandler cycleCounterHandler);
+
+/**
+ * \brief Get the statistics for a feature type
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] featureType               Feature type, 0-15
+ * \param[out] statistics               Statistics struct to fill
+ *
+ * \return RESULT_SUCCESS on success, RESULT_FAIL_INVALID_PARAMETER if the featureType is invalid
+ */
+diypinball_result_t diypinball_featureRouter_getStatistics(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType, diypinball_featureStatistics_t *statistics);
+
+/**
+ * \brief Clear the statistics for all feature types
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_resetStatistics(diypinball_featureRouterInstance_t *featureRouterInstance);
+
+/**
+ * \brief Count a message for a function the FeatureHandler doesn't implement
+ *
+ * \param[in] featureRouterInstance     FeatureRouter instance struct
+ * \param[in] featureType               Feature type of the FeatureHandler
+ *
+ * \return Nothing
+ */
+void diypinball_featureRouter_reportUnknownFunction(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType);
+#else
+#define diypinball_featureRouter_reportUnknownFunction(featureRouterInstance, featureType) do { } while(0)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -83,9 +83,9 @@ void diypinball_lampFeatureHandler_init(diypinball_lampFeatureHandlerInstance_t
  * \param[in] instance                  LampFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_lampFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_lampFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a LampFeatureHandler instance
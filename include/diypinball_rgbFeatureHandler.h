@@ -79,9 +79,9 @@ void diypinball_rgbFeatureHandler_init(diypinball_rgbFeatureHandlerInstance_t *i
  * \param[in] instance                  RGBFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_rgbFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_rgbFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a RGBFeatureHandler instance
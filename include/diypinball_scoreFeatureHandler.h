@@ -27,6 +27,11 @@ extern "C" {
 
 #include <stdint.h>
 
+/*
+ * \brief Number of characters in the display buffer - one frame's worth, so 64 with CAN FD
+ */
+#define DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH DIYPINBALL_MAX_DATA_LENGTH
+
 /*
  * \brief Function pointer to a score changed handler, whose implementation is platform-specific
  */
@@ -43,7 +48,7 @@ typedef void (*diypinball_scoreFeatureHandlerBrightnessChangedHandler)(uint8_t b
  */
 typedef struct diypinball_scoreFeatureHandlerInstance {
     diypinball_featureHandlerInstance_t featureHandlerInstance;             /**< featureDecoder instance for the FeatureRouter */
-    char display[8];
+    char display[DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH];
     uint8_t brightness;
     diypinball_scoreFeatureHandlerDisplayChangedHandler displayChangedHandler;
     diypinball_scoreFeatureHandlerBrightnessChangedHandler brightnessChangedHandler;
@@ -75,9 +80,9 @@ void diypinball_scoreFeatureHandler_init(diypinball_scoreFeatureHandlerInstance_
  * \param[in] instance                  ScoreFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_scoreFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_scoreFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a ScoreFeatureHandler instance
@@ -24,19 +24,112 @@ extern "C" {
 
 #include "diypinball.h"
 #include "diypinball_featureRouter.h"
+#include "diypinball_coilEnvelopeGenerator.h"
 
 #include <stdint.h>
 
+/*
+ * \brief Largest number of switches a SwitchFeatureHandler can scan, in banks of 16. Switches past the first
+ * bank are addressed by carrying the bank number in bits 0-2 of the reserved field alongside featureNum
+ */
+#ifndef DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES
+#define DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES 16
+#endif
+
+#if (DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES % 16) || (DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES < 16) || (DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES > 128)
+#error "DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES must be a multiple of 16 between 16 and 128"
+#endif
+
+#define DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT (DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES / 16)
+
+/*
+ * \brief Number of entries in the switch action table, addressed by featureNum in switch function 0x09
+ */
+#ifndef DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT
+#define DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT 8
+#endif
+
+#if (DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT < 1) || (DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT > 16)
+#error "DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT must be between 1 and 16"
+#endif
+
+/*
+ * \brief Number of switch transitions kept for replay through switch function 0x0A, must be a power of two
+ */
+#ifndef DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE
+#define DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE 16
+#endif
+
+#if (DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE & (DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE - 1)) || (DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE < 1) || (DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE > 128)
+#error "DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE must be a power of two no larger than 128"
+#endif
+
+/*
+ * \brief CAN priority switches report with until switch function 0x0E changes it, lower wins arbitration
+ */
+#ifndef DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY
+#define DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY 0x01
+#endif
+
+#if (DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY < 0) || (DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY > 15)
+#error "DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY must be between 0 and 15"
+#endif
+
+/*
+ * \brief Set to 1 to keep per-switch activation and bounce statistics in the SwitchFeatureHandler
+ */
+#ifndef DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+#define DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS 0
+#endif
+
+/*
+ * \brief Switch action types
+ */
+#define DIYPINBALL_SWITCHACTION_NONE 0x00               /**< Table entry unused */
+#define DIYPINBALL_SWITCHACTION_COIL 0x01               /**< Coil status command, params are attack status/duration and sustain status/duration */
+#define DIYPINBALL_SWITCHACTION_LAMP 0x02               /**< Lamp status command, params are two lamp states and durations */
+#define DIYPINBALL_SWITCHACTION_RGB 0x03                /**< RGB status command, params are red, green and blue */
+#define DIYPINBALL_SWITCHACTION_HOST 0x04               /**< Switch function 0x09 response to the host, params are the data */
+
+/*
+ * \brief Switch action guard bits, the low nibble holds the switch in the action switch's bank whose current state is checked.
+ * A guard can only name a switch in the same bank as the action's switch, bits 0x30 are reserved and must be 0.
+ */
+#define DIYPINBALL_SWITCHACTION_GUARD_ENABLE 0x80       /**< Only run the action when the guard switch is in the required state */
+#define DIYPINBALL_SWITCHACTION_GUARD_CLOSED 0x40       /**< Required state of the guard switch is closed, otherwise open */
+
+/*
+ * \brief Switch faults, reported through switch function 0x0D
+ */
+#define DIYPINBALL_SWITCHFAULT_NONE 0x00                /**< Fault cleared, the switch reports normally again */
+#define DIYPINBALL_SWITCHFAULT_CHATTER 0x01             /**< More edges in the chatter window than allowed, transitions are suppressed until a quiet window passes */
+#define DIYPINBALL_SWITCHFAULT_STUCK 0x02               /**< Closed for longer than the stuck limit, cleared when the switch opens */
+
 /*
  * \brief Function pointer to a read switch state handler, whose implementation is platform-specific
  */
 typedef void (*diypinball_switchFeatureHandlerReadStateHandler)(uint8_t *state, uint8_t switchNum);
 
+/*
+ * \brief Function pointer to a handler reading a bank of 16 switch states at once, bit n = switch bank * 16 + n closed, whose implementation is platform-specific
+ */
+typedef void (*diypinball_switchFeatureHandlerReadAllStatesHandler)(uint16_t *states, uint8_t bank);
+
 /*
  * \brief Function pointer to a debounce parameter change handler, whose implementation is platform-specific
  */
 typedef void (*diypinball_switchFeatureHandlerDebounceChangedHandler)(uint8_t switchNum, uint8_t debounceLimit);
 
+/*
+ * \brief Function pointer to a debounce parameter change handler for a set of switches configured together, whose implementation is platform-specific
+ */
+typedef void (*diypinball_switchFeatureHandlerBulkDebounceChangedHandler)(uint8_t bank, uint16_t switchMask, uint8_t debounceLimit);
+
+/*
+ * \brief Function pointer to a free-running microsecond counter used to timestamp switch reports, whose implementation is platform-specific
+ */
+typedef uint32_t (*diypinball_switchFeatureHandlerTimestampHandler)(void);
+
 /*
  * \struct diypinball_switchRule_t diypinball_switchRule
  * \brief Stores information related to a switch matrix hardware rule
@@ -48,21 +141,72 @@ typedef struct diypinball_switchRule {
     uint8_t attackDuration;                                                 /**< The duration of the solenoid attack phase, in 10ms units */
     uint8_t sustainStatus;                                                  /**< The PWM level at which to drive the solenoid during sustain */
     uint8_t sustainDuration;                                                /**< The duration of the solenoid sustain phase */
+    diypinball_canMessage_t frame;                                          /**< Pre-encoded solenoid command, rebuilt whenever the rule is set */
+    uint16_t cooldown;                                                      /**< Minimum time in ms between two firings of the rule, 0 = no cooldown */
+    uint32_t lastFireTick;                                                  /**< Timer tick at which the rule last fired */
+    uint16_t suppressedCount;                                               /**< Firings dropped for falling within the cooldown, saturates at 0xFFFF */
 } diypinball_switchRule_t;
 
+/*
+ * \struct diypinball_switchAction_t diypinball_switchAction
+ * \brief Stores one entry of the switch action table - something to do when a switch changes state
+ */
+typedef struct diypinball_switchAction {
+    uint8_t switchNum;                                                      /**< Switch whose transitions trigger the action */
+    uint8_t eventMask;                                                      /**< Transitions that trigger the action, 0x01 = close, 0x02 = open */
+    uint8_t type;                                                           /**< Action type, one of DIYPINBALL_SWITCHACTION_* */
+    uint8_t targetNum;                                                      /**< Coil, lamp or RGB number on the target board */
+    uint8_t guard;                                                          /**< Guard on another switch's state, see DIYPINBALL_SWITCHACTION_GUARD_* */
+    uint8_t boardAddress;                                                   /**< Board address to send the action's message to */
+    uint8_t params[4];                                                      /**< Action data, see the action types */
+} diypinball_switchAction_t;
+
+/*
+ * \struct diypinball_switchJournalEntry_t diypinball_switchJournalEntry
+ * \brief Stores one switch transition in the replay journal
+ */
+typedef struct diypinball_switchJournalEntry {
+    uint8_t sequence;                                                       /**< Sequence number of the transition */
+    uint8_t switchNum;                                                      /**< Switch that changed */
+    uint8_t state;                                                          /**< New state of the switch */
+    uint32_t eventTime;                                                     /**< Timestamp of the transition */
+} diypinball_switchJournalEntry_t;
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+#define DIYPINBALL_SWITCHSTATISTICS_NO_TIME 0xFFFF         /**< Shortest duration not measured yet */
+
+/*
+ * \struct diypinball_switchStatistics_t diypinball_switchStatistics
+ * \brief Activation and bounce counters for a single switch, for tuning its debounce limit
+ */
+typedef struct diypinball_switchStatistics {
+    uint16_t activationCount;                                               /**< Accepted closes, saturating */
+    uint16_t bounceCount;                                                   /**< Edges rejected inside the debounce window, saturating */
+    uint16_t minClosedTime;                                                 /**< Shortest accepted closed period in ms, DIYPINBALL_SWITCHSTATISTICS_NO_TIME until measured */
+    uint16_t minOpenTime;                                                   /**< Shortest accepted open period in ms, DIYPINBALL_SWITCHSTATISTICS_NO_TIME until measured */
+} diypinball_switchStatistics_t;
+#endif
+
 /*
  * \struct diypinball_switchStatus_t diypinball_switchStatus
  * \brief Stores information related to an individual switch in the matrix
  */
 typedef struct diypinball_switchStatus {
-    uint8_t lastState;                                                      /**< The previous state of the switch */
-    uint8_t messageTriggerMask;                                             /**< The mask to indicate which transitions should trigger an automatic response */
     uint8_t pollingInterval;                                                /**< Interval to automatically send out switch status messages */
-    uint32_t lastTick;                                                      /**< Last timer tick */
+    uint32_t lastTick;                                                      /**< Timer tick of the last poll, or of when polling was set up */
     uint8_t debounceLimit;                                                  /**< Debounce limit parameter */
-    uint8_t ruleMask;                                                       /**< Event mask for firing hardware rules */
+    uint32_t eventTime;                                                     /**< Timestamp of the last registered transition or read of the switch */
+    uint32_t closeTick;                                                     /**< Timer tick at which the switch last closed, for stuck detection */
+    uint32_t chatterTick;                                                   /**< Timer tick at which the chatter window started, or of the last edge while chattering */
+    uint8_t chatterCount;                                                   /**< Edges counted in the current chatter window */
+    uint8_t reportPriority;                                                 /**< CAN priority of the switch's unsolicited reports */
+    uint8_t journalSequence;                                                /**< Journal sequence number of the switch's newest transition */
     diypinball_switchRule_t closeRule;                                /**< Rule for when the switch is closed */
     diypinball_switchRule_t openRule;                                 /**< Rule for when the switch is opened */
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+    diypinball_switchStatistics_t statistics;                               /**< Activation and bounce counters */
+    uint32_t transitionTick;                                                /**< Timer tick of the last registered transition */
+#endif
 } diypinball_switchStatus_t;
 
 /*
@@ -71,10 +215,46 @@ typedef struct diypinball_switchStatus {
  */
 typedef struct diypinball_switchFeatureHandlerInstance {
     diypinball_featureHandlerInstance_t featureHandlerInstance;             /**< featureDecoder instance for the FeatureRouter */
-    diypinball_switchStatus_t switches[16];                           /**< Array of switch status objects */
-    uint8_t numSwitches;                                                    /**< The number of switches to be scanned */
+    diypinball_switchStatus_t switches[DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES]; /**< Array of switch status objects */
+    uint16_t switchState[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];       /**< Bitmaps of the last registered switch states per bank, bit n = switch n of the bank closed */
+    uint16_t pollingMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];       /**< Bitmaps of switches with a polling interval */
+    uint8_t pollingBanks;                                                   /**< Bitmap of banks with a nonzero pollingMask */
+    uint32_t nextPollTick;                                                  /**< Earliest tick at which a switch in pollingMask is due */
+    uint16_t closeTriggerMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];  /**< Bitmaps of switches that send a status message when closed */
+    uint16_t openTriggerMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];   /**< Bitmaps of switches that send a status message when opened */
+    uint16_t closeRuleMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];     /**< Bitmaps of switches with an enabled close rule */
+    uint16_t openRuleMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];      /**< Bitmaps of switches with an enabled open rule */
+    uint8_t deltaReportWindow;                                              /**< Window in ms over which triggered transitions are coalesced into one delta report, 0 = one status message per transition */
+    uint16_t pendingDeltaMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];  /**< Bitmaps of triggered switches that changed since the last delta report */
+    uint8_t pendingDeltaBanks;                                              /**< Bitmap of banks with a nonzero pendingDeltaMask */
+    uint32_t deltaStartTick;                                                /**< Timer tick at which the first pending transition was registered */
+    uint32_t deltaStartTime;                                                /**< Timestamp of the first pending transition */
+    diypinball_switchFeatureHandlerTimestampHandler timestampHandler;       /**< Microsecond counter stamped onto switch reports, NULL for the plain report formats */
+    diypinball_coilEnvelopeGeneratorInstance_t *localCoils;                 /**< CoilEnvelopeGenerator driving this board's coils, or NULL to send every rule over CAN */
+    uint8_t announceLocalRules;                                             /**< Whether rules delivered to localCoils are also sent over CAN for information */
+    diypinball_switchAction_t actions[DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT]; /**< Switch action table */
+    uint16_t actionSwitchMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];  /**< Bitmaps of switches that have at least one action */
+    uint8_t chatterLimit;                                                   /**< Edges allowed per chatter window before a switch is suppressed, 0 = chatter detection off */
+    uint8_t chatterWindow;                                                  /**< Chatter window in ms */
+    uint8_t stuckLimit;                                                     /**< Time in 100ms units a switch may stay closed before it is reported stuck, 0 = stuck detection off */
+    uint16_t chatterMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];       /**< Bitmaps of switches suppressed for chattering */
+    uint8_t chatterBanks;                                                   /**< Bitmap of banks with a nonzero chatterMask */
+    uint16_t stuckMask[DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT];         /**< Bitmaps of switches reported stuck */
+    uint32_t nextStuckTick;                                                 /**< Earliest tick at which a closed switch becomes stuck */
+    uint8_t stuckCheckPending;                                              /**< Whether nextStuckTick is set */
+    diypinball_switchJournalEntry_t journal[DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE]; /**< Ring buffer of recent transitions */
+    uint8_t journalHead;                                                    /**< Journal slot the next transition is written to */
+    uint8_t journalCount;                                                   /**< Number of transitions held in the journal */
+    uint8_t journalSequence;                                                /**< Sequence number of the newest transition, the first one is 1 */
+    uint8_t reportJournalSequence;                                          /**< Whether switch reports end with a journal sequence number */
+    uint8_t replaySequence;                                                 /**< Sequence number of the next journal entry to replay */
+    uint8_t replayCount;                                                    /**< Journal entries left to replay */
+    uint8_t replayPriority;                                                 /**< CAN priority of the replay, taken from the message that started it */
+    uint8_t numSwitches;                                                    /**< The number of switches to be scanned, at most DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES */
     diypinball_switchFeatureHandlerReadStateHandler readStateHandler;               /**< Function pointer to the read switch state handler */
+    diypinball_switchFeatureHandlerReadAllStatesHandler readAllStatesHandler;       /**< Function pointer to the bank read handler, NULL to read through readStateHandler */
     diypinball_switchFeatureHandlerDebounceChangedHandler debounceChangedHandler;   /**< Function pointer to the debounce parameter change handler */
+    diypinball_switchFeatureHandlerBulkDebounceChangedHandler bulkDebounceChangedHandler; /**< Function pointer to the bulk debounce change handler, NULL to call debounceChangedHandler per switch */
 } diypinball_switchFeatureHandlerInstance_t;
 
 /*
@@ -84,6 +264,7 @@ typedef struct diypinball_switchFeatureHandlerInstance {
 typedef struct diypinball_switchFeatureHandlerInit {
     uint8_t numSwitches;                                                    /**< The number of switches to be scanned */
     diypinball_switchFeatureHandlerReadStateHandler readStateHandler;               /**< Function pointer to the read switch state handler */
+    diypinball_switchFeatureHandlerReadAllStatesHandler readAllStatesHandler;       /**< Function pointer to the bank read handler, or NULL - used by status requests and polling when provided */
     diypinball_switchFeatureHandlerDebounceChangedHandler debounceChangedHandler;   /**< Function pointer to the debounce parameter change handler */
     diypinball_featureRouterInstance_t *routerInstance;                       /**< FeatureRouter instance to connect to */
 } diypinball_switchFeatureHandlerInit_t;
@@ -104,9 +285,9 @@ void diypinball_switchFeatureHandler_init(diypinball_switchFeatureHandlerInstanc
  * \param[in] instance                  SwitchFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_switchFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_switchFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a SwitchFeatureHandler instance
@@ -138,6 +319,94 @@ void diypinball_switchFeatureHandler_deinit(diypinball_switchFeatureHandlerInsta
  */
 void diypinball_switchFeatureHandler_registerSwitchState(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t state);
 
+/**
+ * \brief Register the state of every switch in the first bank at once with the SwitchFeatureHandler
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] states                    Bitmap of current states, bit n = switch n closed
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_registerSwitchStates(diypinball_switchFeatureHandlerInstance_t *instance, uint16_t states);
+
+/**
+ * \brief Register the state of every switch in one bank of 16 at once with the SwitchFeatureHandler
+ *
+ * Only switches whose state differs from the last registered state are processed, in
+ * ascending switch order, so an unchanged bitmap costs a single comparison. When a delta report
+ * window is set, triggered transitions are gathered into one delta report (function 0x07) that is
+ * sent once the window expires; rules still fire immediately.
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] bank                      Which bank is being updated, covering switches bank * 16 to bank * 16 + 15
+ * \param[in] states                    Bitmap of current states, bit n = switch bank * 16 + n closed
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_registerSwitchBankStates(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t states);
+
+/**
+ * \brief Deliver rules that target this board's own address straight to a CoilEnvelopeGenerator, rather
+ * than sending them over CAN and waiting for them to come back
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] localCoils                CoilEnvelopeGenerator instance for this board's coils, or NULL to disable
+ * \param[in] announce                  Nonzero to also send locally delivered rules over CAN
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_setLocalCoils(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_coilEnvelopeGeneratorInstance_t *localCoils, uint8_t announce);
+
+/**
+ * \brief Set the microsecond counter used to timestamp switch reports. While set, switch status messages
+ * (function 0x00) carry the 4-byte time the state was registered or read in data[2-5], and delta and
+ * grouped poll reports carry it in data[4-7]
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] timestampHandler          Pointer to the counter read function, NULL for the plain report formats
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_setTimestampHandler(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchFeatureHandlerTimestampHandler timestampHandler);
+
+/**
+ * \brief Append the journal sequence number to switch reports, so a host can tell which transitions it has
+ * seen and replay the rest through function 0x0A. While set, switch status messages (function 0x00) end with
+ * the sequence number of the switch's newest transition, and delta and grouped poll reports end with the
+ * newest sequence number in the journal. On classic CAN, a delta or poll report that also carries a timestamp
+ * keeps only its low 3 bytes to make room.
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] enable                    Nonzero to append the sequence number, 0 for the plain report formats
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_setJournalSequenceReports(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t enable);
+
+/**
+ * \brief Set the handler told about debounce changes made by one bulk configuration message (function 0x0B),
+ * called once with the whole set of switches instead of once per switch
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] bulkDebounceChangedHandler Pointer to the bulk handler, NULL to call debounceChangedHandler for each switch
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_setBulkDebounceChangedHandler(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchFeatureHandlerBulkDebounceChangedHandler bulkDebounceChangedHandler);
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+/**
+ * \brief Count an edge that the platform's debouncing rejected, for the bounce statistics read through
+ * switch function 0x0C
+ *
+ * \param[in] instance                  SwitchFeatureHandler instance struct
+ * \param[in] switchNum                 Which switch bounced
+ *
+ * \return Nothing
+ */
+void diypinball_switchFeatureHandler_registerSwitchBounce(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
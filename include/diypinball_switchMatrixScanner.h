@@ -41,6 +41,12 @@ typedef enum diypinball_switchMatrixScanner_interruptType {
  */
 typedef void (*diypinball_switchMatrixScannerSwitchStateHandler)(uint8_t switchNum, uint8_t state);
 
+/*
+ * \brief Function pointer to a switch bounce handler, called for each raw edge the debounce window rejected.
+ * Typically calls diypinball_switchFeatureHandler_registerSwitchBounce so the bounce shows in the switch statistics.
+ */
+typedef void (*diypinball_switchMatrixScannerSwitchBounceHandler)(uint8_t switchNum);
+
 /*
  * \brief Function pointer to a set column handler, whose implementation is platform-specific. -1 deasserts all columns.
  */
@@ -59,6 +65,7 @@ typedef struct diypinball_switchMatrixStatus {
     uint8_t switchState;                                                    /**< The previous state of the switch */
     uint32_t lastTick;                                                      /**< Last timer tick where a change occured*/
     uint8_t debounceLimit;                                                  /**< Debounce limit parameter */
+    uint8_t rawState;                                                       /**< State read on the last scan, accepted or not */
 } diypinball_switchMatrixStatus_t;
 
 /*
@@ -71,6 +78,7 @@ typedef struct diypinball_switchMatrixScannerInstance {
     uint8_t currentColumn;                                                  /**< The current column being scanned */
     uint32_t lastTick;                                                   /**< Most recent tick number */
     diypinball_switchMatrixScannerSwitchStateHandler switchStateHandler;    /**< Function pointer to the switch state handler */
+    diypinball_switchMatrixScannerSwitchBounceHandler switchBounceHandler;  /**< Function pointer to the switch bounce handler, NULL if bounces aren't counted */
     diypinball_switchMatrixScannerSetColumnHandler setColumnHandler;        /**< Function pointer to the set column handler */
     diypinball_switchMatrixScannerReadRowHandler readRowHandler;            /**< Function pointer to the read row handler */
 } diypinball_switchMatrixScannerInstance_t;
@@ -82,6 +90,7 @@ typedef struct diypinball_switchMatrixScannerInstance {
 typedef struct diypinball_switchMatrixScannerInit {
     uint8_t numColumns;                                                     /**< The number of columns to be scanned */
     diypinball_switchMatrixScannerSwitchStateHandler switchStateHandler;    /**< Function pointer to the switch state handler */
+    diypinball_switchMatrixScannerSwitchBounceHandler switchBounceHandler;  /**< Function pointer to the switch bounce handler, NULL if bounces aren't counted */
     diypinball_switchMatrixScannerSetColumnHandler setColumnHandler;        /**< Function pointer to the set column handler */
     diypinball_switchMatrixScannerReadRowHandler readRowHandler;            /**< Function pointer to the read row handler */
 } diypinball_switchMatrixScannerInit_t;
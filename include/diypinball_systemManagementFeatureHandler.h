@@ -78,9 +78,9 @@ void diypinball_systemManagementFeatureHandler_init(diypinball_systemManagementF
  * \param[in] instance                  SystemManagementFeatureHandler instance struct
  * \param[in] tickNum                   Current timer tick
  *
- * \return Nothing
+ * \return Number of ticks until the handler next needs to run, or DIYPINBALL_TICK_NONE
  */
-void diypinball_systemManagementFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
+uint32_t diypinball_systemManagementFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum);
 
 /**
  * \brief Process a received Pinball message meant for a SystemManagementFeatureHandler instance
@@ -48,8 +48,8 @@ void diypinball_bootloaderControlFeatureHandler_init(diypinball_bootloaderContro
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_bootloaderControlFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
-
+uint32_t diypinball_bootloaderControlFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+    return DIYPINBALL_TICK_NONE;
 }
 
 void diypinball_bootloaderControlFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -63,6 +63,7 @@ void diypinball_bootloaderControlFeatureHandler_messageReceivedHandler(void *ins
         if(message->messageType == MESSAGE_COMMAND) doBootloaderReboot(typedInstance, message);
         break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 }
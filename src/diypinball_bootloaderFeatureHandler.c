@@ -189,6 +189,10 @@ static void doApplicationReboot(diypinball_bootloaderFeatureHandlerInstance_t* i
 
 static void runWriteToBuffer(diypinball_bootloaderFeatureHandlerInstance_t* instance, diypinball_pinballMessage_t *message) {
     uint8_t offset, i;
+#if DIYPINBALL_CAN_FD
+    uint8_t chunk[8];
+    uint8_t chunkLength;
+#endif
 
     offset = 0;
     offset |= message->featureNum & 0x0f;
@@ -202,6 +206,18 @@ static void runWriteToBuffer(diypinball_bootloaderFeatureHandlerInstance_t* inst
     }
 
     (instance->bufferWriteHandler)(offset, message->data);
+
+#if DIYPINBALL_CAN_FD
+    // a CAN FD frame carries up to 8 consecutive chunks; a partial last chunk is padded like a short frame
+    for(i = 8; (i < message->dataLength) && (offset < 127); i += 8) {
+        chunkLength = ((message->dataLength - i) < 8) ? (message->dataLength - i) : 8;
+
+        memset(chunk, 0xff, 8);
+        memcpy(chunk, &(message->data[i]), chunkLength);
+        offset++;
+        (instance->bufferWriteHandler)(offset, chunk);
+    }
+#endif
 }
 
 static void runReadFromBuffer(diypinball_bootloaderFeatureHandlerInstance_t* instance, diypinball_pinballMessage_t *message) {
@@ -253,8 +269,8 @@ void diypinball_bootloaderFeatureHandler_init(diypinball_bootloaderFeatureHandle
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_bootloaderFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
-
+uint32_t diypinball_bootloaderFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+    return DIYPINBALL_TICK_NONE;
 }
 
 void diypinball_bootloaderFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -305,6 +321,8 @@ void diypinball_bootloaderFeatureHandler_messageReceivedHandler(void *instance,
             } else if(message->messageType == MESSAGE_COMMAND) {
                 runWriteToBuffer(typedInstance, message);
             }
+        } else {
+            diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         }
         break;
     }
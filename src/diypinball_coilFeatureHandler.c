@@ -72,8 +72,8 @@ void diypinball_coilFeatureHandler_init(diypinball_coilFeatureHandlerInstance_t
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_coilFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
-    
+uint32_t diypinball_coilFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+    return DIYPINBALL_TICK_NONE;
 }
 
 void diypinball_coilFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -88,6 +88,7 @@ void diypinball_coilFeatureHandler_messageReceivedHandler(void *instance, diypin
         }
         break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 
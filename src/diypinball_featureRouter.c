@@ -4,15 +4,587 @@
 #include <stdint.h>
 #include <string.h>
 
+#define RX_QUEUE_MASK (DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE - 1)
+
+// keeps the compiler from reordering queue slot accesses around the index updates
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define COMPILER_BARRIER() _ReadWriteBarrier()
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define COMPILER_BARRIER() atomic_signal_fence(memory_order_seq_cst)
+#else
+#define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+static void resetRxQueue(diypinball_featureRouterRxQueue_t *queue) {
+    queue->head = 0;
+    queue->tail = 0;
+    queue->highWaterMark = 0;
+    queue->overflowCount = 0;
+}
+
+static void resetTxQueue(diypinball_featureRouterTxQueue_t *queue) {
+    queue->depth = 0;
+    queue->count = 0;
+    queue->peakCount = 0;
+    queue->dropCount = 0;
+    queue->lockHandler = NULL;
+    queue->unlockHandler = NULL;
+}
+
+static void lockTxQueue(diypinball_featureRouterTxQueue_t *queue) {
+    if(queue->lockHandler) {
+        queue->lockHandler();
+    }
+}
+
+static void unlockTxQueue(diypinball_featureRouterTxQueue_t *queue) {
+    if(queue->unlockHandler) {
+        queue->unlockHandler();
+    }
+}
+
+static void enqueueTx(diypinball_featureRouterTxQueue_t *queue, diypinball_canMessage_t *message) {
+    uint8_t i;
+
+    if(queue->count >= queue->depth) {
+        queue->dropCount++;
+        // the head of the array holds the least urgent message - evict it if the new one outranks it
+        if(message->id >= queue->messages[0].id) {
+            return;
+        }
+        for(i = 0; i < (queue->count - 1); i++) {
+            queue->messages[i] = queue->messages[i + 1];
+        }
+        queue->count--;
+    }
+
+    // insertion sort, highest ID first; equal IDs stay in FIFO order since the tail is sent first
+    i = queue->count;
+    while((i > 0) && (queue->messages[i - 1].id <= message->id)) {
+        queue->messages[i] = queue->messages[i - 1];
+        i--;
+    }
+    queue->messages[i] = *message;
+    queue->count++;
+
+    if(queue->count > queue->peakCount) {
+        queue->peakCount = queue->count;
+    }
+}
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+#define STATISTICS(featureRouterInstance, featureType) ((featureRouterInstance)->statistics[(featureType) & 0x0F])
+#define MESSAGE_FEATURE_TYPE(message) (((message)->id & 0x0000F000) >> 12)
+
+static void resetStatistics(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    memset(featureRouterInstance->statistics, 0, sizeof(featureRouterInstance->statistics));
+}
+
+static void dispatchTimed(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_featureHandlerInstance_t *feature, diypinball_pinballMessageView_t *view, diypinball_pinballMessage_t *decodedMessage) {
+    diypinball_featureStatistics_t *statistics = &STATISTICS(featureRouterInstance, feature->featureType);
+    uint32_t startCycles = 0;
+    uint32_t cycles;
+
+    statistics->rxCount++;
+
+    if(featureRouterInstance->cycleCounterHandler) {
+        startCycles = featureRouterInstance->cycleCounterHandler();
+    }
+
+    if(featureRouterInstance->viewHandlers[feature->featureType]) {
+        (featureRouterInstance->viewHandlers[feature->featureType])(feature->concreteFeatureHandlerInstance, view);
+    } else {
+        (feature->messageHandler)(feature->concreteFeatureHandlerInstance, decodedMessage);
+    }
+
+    if(featureRouterInstance->cycleCounterHandler) {
+        cycles = featureRouterInstance->cycleCounterHandler() - startCycles;
+        if((statistics->handlerCallCount == 0) || (cycles < statistics->handlerCyclesMin)) {
+            statistics->handlerCyclesMin = cycles;
+        }
+        if(cycles > statistics->handlerCyclesMax) {
+            statistics->handlerCyclesMax = cycles;
+        }
+        statistics->handlerCyclesTotal += cycles;
+        statistics->handlerCallCount++;
+    }
+}
+#endif
+
+static void resetTxBatch(diypinball_featureRouterTxBatch_t *batch) {
+    batch->count = 0;
+    batch->openCount = 0;
+}
+
+static void flushTxBatch(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    diypinball_featureRouterTxBatch_t *batch = &(featureRouterInstance->txBatch);
+
+    if(batch->count) {
+        featureRouterInstance->canSendBatchHandler(batch->messages, batch->count);
+        batch->count = 0;
+    }
+}
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+// arbitration ID without the reserved field, which carries the segment frame type
+#define SEGMENT_ID_MASK 0xFFFFFFF0
+// fields that identify a transfer - board address, feature type, feature number and function
+#define SEGMENT_MATCH_MASK 0x00FFFFF0
+
+static void resetSegmentRx(diypinball_featureRouterSegmentRx_t *segmentRx) {
+    segmentRx->id = 0;
+    segmentRx->length = 0;
+    segmentRx->received = 0;
+    segmentRx->sequence = 0;
+    segmentRx->blockRemaining = 0;
+    segmentRx->lastTick = 0;
+}
+
+static void resetSegmentTx(diypinball_featureRouterSegmentTx_t *segmentTx) {
+    segmentTx->id = 0;
+    segmentTx->length = 0;
+    segmentTx->sent = 0;
+    segmentTx->sequence = 0;
+    segmentTx->waiting = 0;
+    segmentTx->blockRemaining = 0;
+    segmentTx->separationTime = 0;
+    segmentTx->lastTick = 0;
+}
+
+// only the three segment frame types are claimed, other reserved values route normally
+static uint8_t isSegmentFrame(uint32_t id) {
+    return ((id & 0x0F) == DIYPINBALL_SEGMENT_FIRST_FRAME) || ((id & 0x0F) == DIYPINBALL_SEGMENT_CONSECUTIVE_FRAME) ||
+        ((id & 0x0F) == DIYPINBALL_SEGMENT_FLOW_CONTROL);
+}
+
+static uint8_t isSegmentTxFrame(diypinball_featureRouterInstance_t *featureRouterInstance, uint32_t id) {
+    diypinball_featureRouterSegmentTx_t *segmentTx = &(featureRouterInstance->segmentTx);
+
+    return segmentTx->length && ((id & SEGMENT_ID_MASK) == segmentTx->id) &&
+        (((id & 0x0F) == DIYPINBALL_SEGMENT_FIRST_FRAME) || ((id & 0x0F) == DIYPINBALL_SEGMENT_CONSECUTIVE_FRAME));
+}
+
+static uint8_t isTxQueueFull(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    return featureRouterInstance->txQueue.depth && (featureRouterInstance->txQueue.count >= featureRouterInstance->txQueue.depth);
+}
+#endif
+
+// hand one message to the HAL, a batch-only HAL gets a batch of one
+static void transmitCANMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+    if(featureRouterInstance->canSendHandler) {
+        featureRouterInstance->canSendHandler(message);
+    } else {
+        featureRouterInstance->canSendBatchHandler(message, 1);
+    }
+}
+
+static void sendCANMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    uint32_t dropCount;
+
+    STATISTICS(featureRouterInstance, MESSAGE_FEATURE_TYPE(message)).txCount++;
+#endif
+
+    if(featureRouterInstance->txQueue.depth) {
+        lockTxQueue(&(featureRouterInstance->txQueue));
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+        dropCount = featureRouterInstance->txQueue.dropCount;
+#endif
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+        // a more urgent message evicts the least urgent one from a full queue, the receiver can't recover a
+        // transfer with a frame missing so stop sending the rest of it
+        if((featureRouterInstance->txQueue.count >= featureRouterInstance->txQueue.depth) &&
+            (message->id < featureRouterInstance->txQueue.messages[0].id) && isSegmentTxFrame(featureRouterInstance, featureRouterInstance->txQueue.messages[0].id)) {
+            resetSegmentTx(&(featureRouterInstance->segmentTx));
+        }
+#endif
+        enqueueTx(&(featureRouterInstance->txQueue), message);
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+        if(featureRouterInstance->txQueue.dropCount != dropCount) {
+            // the dropped message may be an evicted one, but attribute it to the sender that hit the full queue
+            STATISTICS(featureRouterInstance, MESSAGE_FEATURE_TYPE(message)).dropCount++;
+        }
+#endif
+        unlockTxQueue(&(featureRouterInstance->txQueue));
+    } else if(featureRouterInstance->txBatch.openCount) {
+        featureRouterInstance->txBatch.messages[featureRouterInstance->txBatch.count] = *message;
+        featureRouterInstance->txBatch.count++;
+        if(featureRouterInstance->txBatch.count >= DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE) {
+            flushTxBatch(featureRouterInstance);
+        }
+    } else {
+        transmitCANMessage(featureRouterInstance, message);
+    }
+}
+
+static void encodePinballMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *message, diypinball_canMessage_t *encodedMessage) {
+    uint8_t boardAddress = 0;
+    uint8_t paddedLength;
+
+    if(message->messageType == MESSAGE_RESPONSE) {
+        boardAddress = featureRouterInstance->boardAddress;
+        encodedMessage->rtr = 0;
+    } else if(message->messageType == MESSAGE_COMMAND) {
+        boardAddress = message->boardAddress;
+        encodedMessage->rtr = 0;
+    } else if(message->messageType == MESSAGE_REQUEST) {
+        boardAddress = message->boardAddress;
+        encodedMessage->rtr = 1;
+    }
+
+    encodedMessage->id = ((message->priority & 0x0f) << 25) | 
+                        ((message->unitSpecific & 0x01) << 24) | 
+                        (boardAddress << 16) | 
+                        ((message->featureType & 0x0f) << 12) | 
+                        ((message->featureNum & 0x0f) << 8) | 
+                        ((message->function & 0x0f) << 4) | 
+                        (message->reserved & 0x0f);
+
+    memcpy(encodedMessage->data, message->data, DIYPINBALL_MAX_DATA_LENGTH);
+    encodedMessage->dlc = diypinball_lengthToDlc(message->dataLength);
+
+    // CAN FD lengths come in steps above 8 bytes, pad out to the next one
+    paddedLength = diypinball_dlcToLength(encodedMessage->dlc);
+    if(message->dataLength < paddedLength) {
+        memset(&(encodedMessage->data[message->dataLength]), 0, paddedLength - message->dataLength);
+    }
+}
+
+// wrap-safe "deadline is at or before tick"
+#define TICK_REACHED(tick, deadline) ((int32_t) ((tick) - (deadline)) >= 0)
+
+static void resetTickSchedule(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    uint8_t i;
+
+    featureRouterInstance->currentTick = 0;
+    featureRouterInstance->tickSourceHandler = NULL;
+    featureRouterInstance->tickPendingMask = 0;
+    featureRouterInstance->nextTickDeadline = 0;
+
+    for(i=0; i<16; i++) {
+        featureRouterInstance->tickDeadlines[i] = 0;
+    }
+}
+
+static void updateNextTickDeadline(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    uint8_t i;
+    uint8_t found = 0;
+
+    for(i=0; i<16; i++) {
+        if(featureRouterInstance->tickPendingMask & (1 << i)) {
+            if(!found || !TICK_REACHED(featureRouterInstance->tickDeadlines[i], featureRouterInstance->nextTickDeadline)) {
+                featureRouterInstance->nextTickDeadline = featureRouterInstance->tickDeadlines[i];
+                found = 1;
+            }
+        }
+    }
+}
+
+// catch up with the platform counter, if there is one, so work done between ticks isn't timed from a stale tick
+static uint32_t readCurrentTick(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    if(featureRouterInstance->tickSourceHandler) {
+        featureRouterInstance->currentTick = featureRouterInstance->tickSourceHandler();
+    }
+
+    return featureRouterInstance->currentTick;
+}
+
+static void setTickDeadline(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType, uint32_t delay) {
+    uint32_t deadline = readCurrentTick(featureRouterInstance) + delay;
+
+    if((featureRouterInstance->tickPendingMask & (1 << featureType)) &&
+        TICK_REACHED(deadline, featureRouterInstance->tickDeadlines[featureType])) {
+        // already due sooner
+        return;
+    }
+
+    featureRouterInstance->tickDeadlines[featureType] = deadline;
+    if(!(featureRouterInstance->tickPendingMask) || TICK_REACHED(featureRouterInstance->nextTickDeadline, deadline)) {
+        featureRouterInstance->nextTickDeadline = deadline;
+    }
+    featureRouterInstance->tickPendingMask |= (1 << featureType);
+}
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+static void sendSegmentFlowControl(diypinball_featureRouterInstance_t *featureRouterInstance, uint32_t id, uint8_t flowStatus) {
+    diypinball_canMessage_t message;
+
+    message.id = (id & SEGMENT_ID_MASK) | DIYPINBALL_SEGMENT_FLOW_CONTROL;
+    message.rtr = 0;
+    message.dlc = 3;
+    memset(message.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
+    message.data[0] = flowStatus;
+    message.data[1] = featureRouterInstance->segmentRx.blockSize;
+    message.data[2] = featureRouterInstance->segmentRx.separationTime;
+
+    sendCANMessage(featureRouterInstance, &message);
+}
+
+static void completeSegmentRx(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    diypinball_featureRouterSegmentRx_t *segmentRx = &(featureRouterInstance->segmentRx);
+    uint8_t featureType = (segmentRx->id & 0x0000F000) >> 12;
+    diypinball_featureHandlerInstance_t *feature = featureRouterInstance->features[featureType];
+    diypinball_bufferReceivedHandler bufferHandler = featureRouterInstance->bufferHandlers[featureType];
+    diypinball_canMessage_t headerFrame;
+    diypinball_pinballMessageView_t view;
+    diypinball_pinballMessage_t header;
+
+    if(feature && bufferHandler) {
+        headerFrame.id = segmentRx->id;
+        headerFrame.rtr = 0;
+        headerFrame.dlc = 0;
+        memset(headerFrame.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
+        view.message = &headerFrame;
+        diypinball_featureRouter_decodeMessageView(&view, &header);
+
+        bufferHandler(feature->concreteFeatureHandlerInstance, &header, segmentRx->buffer, segmentRx->length);
+        setTickDeadline(featureRouterInstance, feature->featureType, 0);
+    }
+
+    resetSegmentRx(segmentRx);
+}
+
+static void receiveSegmentFirstFrame(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+    diypinball_featureRouterSegmentRx_t *segmentRx = &(featureRouterInstance->segmentRx);
+    uint8_t featureType = (message->id & 0x0000F000) >> 12;
+    uint8_t frameLength = diypinball_dlcToLength(message->dlc);
+    uint16_t length;
+    uint8_t chunk;
+
+    // flow control can't be returned for broadcasts, so only unit-specific transfers are accepted
+    if(!(message->id & 0x01000000) || message->rtr || (frameLength < 2) || (featureRouterInstance->features[featureType] == NULL) || (featureRouterInstance->bufferHandlers[featureType] == NULL)) {
+        return;
+    }
+
+    length = (uint16_t) (message->data[0] | (message->data[1] << 8));
+    if(length > DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE) {
+        sendSegmentFlowControl(featureRouterInstance, message->id, DIYPINBALL_SEGMENT_FLOW_OVERFLOW);
+        return;
+    }
+
+    // a new first frame abandons any transfer still being reassembled
+    chunk = frameLength - 2;
+    if(chunk > length) {
+        chunk = length;
+    }
+    segmentRx->id = message->id & SEGMENT_ID_MASK;
+    segmentRx->length = length;
+    memcpy(segmentRx->buffer, &(message->data[2]), chunk);
+    segmentRx->received = chunk;
+    segmentRx->sequence = 1;
+    segmentRx->blockRemaining = segmentRx->blockSize;
+    segmentRx->lastTick = featureRouterInstance->currentTick;
+
+    if(segmentRx->received >= segmentRx->length) {
+        completeSegmentRx(featureRouterInstance);
+    } else {
+        sendSegmentFlowControl(featureRouterInstance, message->id, DIYPINBALL_SEGMENT_FLOW_CONTINUE);
+    }
+}
+
+static void receiveSegmentConsecutiveFrame(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+    diypinball_featureRouterSegmentRx_t *segmentRx = &(featureRouterInstance->segmentRx);
+    uint8_t frameLength = diypinball_dlcToLength(message->dlc);
+    uint16_t chunk;
+
+    if(!(segmentRx->length) || ((message->id ^ segmentRx->id) & SEGMENT_MATCH_MASK) || (frameLength < 1)) {
+        return;
+    }
+
+    if(message->data[0] != segmentRx->sequence) {
+        // a frame went missing, the payload can't be rebuilt
+        resetSegmentRx(segmentRx);
+        return;
+    }
+
+    chunk = frameLength - 1;
+    if(chunk > (segmentRx->length - segmentRx->received)) {
+        chunk = segmentRx->length - segmentRx->received;
+    }
+    memcpy(&(segmentRx->buffer[segmentRx->received]), &(message->data[1]), chunk);
+    segmentRx->received += chunk;
+    segmentRx->sequence++;
+    segmentRx->lastTick = featureRouterInstance->currentTick;
+
+    if(segmentRx->received >= segmentRx->length) {
+        completeSegmentRx(featureRouterInstance);
+    } else if(segmentRx->blockSize) {
+        segmentRx->blockRemaining--;
+        if(segmentRx->blockRemaining == 0) {
+            segmentRx->blockRemaining = segmentRx->blockSize;
+            sendSegmentFlowControl(featureRouterInstance, message->id, DIYPINBALL_SEGMENT_FLOW_CONTINUE);
+        }
+    }
+}
+
+static uint8_t sendSegmentConsecutiveFrame(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    diypinball_featureRouterSegmentTx_t *segmentTx = &(featureRouterInstance->segmentTx);
+    diypinball_canMessage_t message;
+    uint16_t chunk = segmentTx->length - segmentTx->sent;
+
+    // a frame dropped by a full transmit queue would leave a hole in the transfer, try again on the next tick
+    if(isTxQueueFull(featureRouterInstance)) {
+        return 0;
+    }
+
+    if(chunk > (DIYPINBALL_MAX_DATA_LENGTH - 1)) {
+        chunk = DIYPINBALL_MAX_DATA_LENGTH - 1;
+    }
+
+    message.id = segmentTx->id | DIYPINBALL_SEGMENT_CONSECUTIVE_FRAME;
+    message.rtr = 0;
+    message.dlc = diypinball_lengthToDlc(chunk + 1);
+    memset(message.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
+    message.data[0] = segmentTx->sequence;
+    memcpy(&(message.data[1]), &(segmentTx->buffer[segmentTx->sent]), chunk);
+
+    segmentTx->sent += chunk;
+    segmentTx->sequence++;
+    segmentTx->lastTick = featureRouterInstance->currentTick;
+
+    sendCANMessage(featureRouterInstance, &message);
+
+    if(segmentTx->sent >= segmentTx->length) {
+        resetSegmentTx(segmentTx);
+        return 0;
+    }
+
+    if(segmentTx->blockRemaining) {
+        segmentTx->blockRemaining--;
+        if(segmentTx->blockRemaining == 0) {
+            segmentTx->waiting = 1;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void sendSegmentBlock(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    // with a separation time, the rest of the block is paced out by the millisecond tick
+    while(sendSegmentConsecutiveFrame(featureRouterInstance) && !(featureRouterInstance->segmentTx.separationTime));
+}
+
+static void receiveSegmentFlowControl(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+    diypinball_featureRouterSegmentTx_t *segmentTx = &(featureRouterInstance->segmentTx);
+
+    if(!(segmentTx->length) || !(segmentTx->waiting) || ((message->id ^ segmentTx->id) & SEGMENT_MATCH_MASK) || (diypinball_dlcToLength(message->dlc) < 3)) {
+        return;
+    }
+
+    segmentTx->lastTick = featureRouterInstance->currentTick;
+
+    switch(message->data[0]) {
+    case DIYPINBALL_SEGMENT_FLOW_CONTINUE:
+        segmentTx->waiting = 0;
+        segmentTx->blockRemaining = message->data[1];
+        segmentTx->separationTime = message->data[2];
+        sendSegmentBlock(featureRouterInstance);
+        break;
+    case DIYPINBALL_SEGMENT_FLOW_WAIT:
+        break;
+    default:
+        resetSegmentTx(segmentTx);
+        break;
+    }
+}
+
+static void receiveSegmentFrame(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+    switch(message->id & 0x0F) {
+    case DIYPINBALL_SEGMENT_FIRST_FRAME:
+        receiveSegmentFirstFrame(featureRouterInstance, message);
+        break;
+    case DIYPINBALL_SEGMENT_CONSECUTIVE_FRAME:
+        receiveSegmentConsecutiveFrame(featureRouterInstance, message);
+        break;
+    case DIYPINBALL_SEGMENT_FLOW_CONTROL:
+        receiveSegmentFlowControl(featureRouterInstance, message);
+        break;
+    default:
+        break;
+    }
+}
+
+static void serviceSegments(diypinball_featureRouterInstance_t *featureRouterInstance, uint32_t tickNum) {
+    diypinball_featureRouterSegmentRx_t *segmentRx = &(featureRouterInstance->segmentRx);
+    diypinball_featureRouterSegmentTx_t *segmentTx = &(featureRouterInstance->segmentTx);
+
+    if(segmentRx->length && TICK_REACHED(tickNum, segmentRx->lastTick + DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT)) {
+        resetSegmentRx(segmentRx);
+    }
+
+    if(segmentTx->length) {
+        if(segmentTx->waiting) {
+            if(TICK_REACHED(tickNum, segmentTx->lastTick + DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT)) {
+                resetSegmentTx(segmentTx);
+            }
+        } else if(TICK_REACHED(tickNum, segmentTx->lastTick + segmentTx->separationTime)) {
+            sendSegmentBlock(featureRouterInstance);
+        }
+    }
+}
+
+static uint32_t ticksUntil(uint32_t tickNum, uint32_t deadline) {
+    return TICK_REACHED(tickNum, deadline) ? 0 : (deadline - tickNum);
+}
+
+static uint32_t getSegmentTicksUntilDeadline(diypinball_featureRouterInstance_t *featureRouterInstance, uint32_t tickNum) {
+    diypinball_featureRouterSegmentRx_t *segmentRx = &(featureRouterInstance->segmentRx);
+    diypinball_featureRouterSegmentTx_t *segmentTx = &(featureRouterInstance->segmentTx);
+    uint32_t delay = DIYPINBALL_TICK_NONE;
+    uint32_t segmentDelay;
+
+    if(segmentRx->length) {
+        delay = ticksUntil(tickNum, segmentRx->lastTick + DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT);
+    }
+
+    if(segmentTx->length) {
+        if(segmentTx->waiting) {
+            segmentDelay = ticksUntil(tickNum, segmentTx->lastTick + DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT);
+        } else {
+            segmentDelay = ticksUntil(tickNum, segmentTx->lastTick + segmentTx->separationTime);
+        }
+        if(segmentDelay < delay) {
+            delay = segmentDelay;
+        }
+    }
+
+    return delay;
+}
+#endif
+
 void diypinball_featureRouter_init(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_featureRouterInit_t* init) {
     uint8_t i;
 
     for(i=0; i<16; i++) {
         featureRouterInstance->features[i] = NULL;
+        featureRouterInstance->viewHandlers[i] = NULL;
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+        featureRouterInstance->bufferHandlers[i] = NULL;
+#endif
     }
 
     featureRouterInstance->boardAddress = init->boardAddress;
+    featureRouterInstance->groupMask = 0;
     featureRouterInstance->canSendHandler = init->canSendHandler;
+    featureRouterInstance->canSendBatchHandler = NULL;
+
+    resetTxBatch(&(featureRouterInstance->txBatch));
+    resetRxQueue(&(featureRouterInstance->rxQueue));
+    resetTxQueue(&(featureRouterInstance->txQueue));
+    resetTickSchedule(featureRouterInstance);
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    resetSegmentRx(&(featureRouterInstance->segmentRx));
+    resetSegmentTx(&(featureRouterInstance->segmentTx));
+    featureRouterInstance->segmentRx.blockSize = 0;
+    featureRouterInstance->segmentRx.separationTime = 0;
+#endif
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    resetStatistics(featureRouterInstance);
+    featureRouterInstance->cycleCounterHandler = NULL;
+#endif
 
     return;
 }
@@ -22,10 +594,31 @@ void diypinball_featureRouter_deinit(diypinball_featureRouterInstance_t* feature
 
     for(i=0; i<16; i++) {
         featureRouterInstance->features[i] = NULL;
+        featureRouterInstance->viewHandlers[i] = NULL;
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+        featureRouterInstance->bufferHandlers[i] = NULL;
+#endif
     }
 
     featureRouterInstance->boardAddress = 0;
+    featureRouterInstance->groupMask = 0;
     featureRouterInstance->canSendHandler = NULL;
+    featureRouterInstance->canSendBatchHandler = NULL;
+
+    resetTxBatch(&(featureRouterInstance->txBatch));
+    resetRxQueue(&(featureRouterInstance->rxQueue));
+    resetTxQueue(&(featureRouterInstance->txQueue));
+    resetTickSchedule(featureRouterInstance);
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    resetSegmentRx(&(featureRouterInstance->segmentRx));
+    resetSegmentTx(&(featureRouterInstance->segmentTx));
+    featureRouterInstance->segmentRx.blockSize = 0;
+    featureRouterInstance->segmentRx.separationTime = 0;
+#endif
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    resetStatistics(featureRouterInstance);
+    featureRouterInstance->cycleCounterHandler = NULL;
+#endif
 
     return;
 }
@@ -35,36 +628,246 @@ diypinball_result_t diypinball_featureRouter_addFeature(diypinball_featureRouter
 
     if((featureNum >= 0) && (featureNum < 16)) {
         featureRouterInstance->features[featureNum] = featureHandlerInstance;
+        featureRouterInstance->viewHandlers[featureNum] = NULL;
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+        featureRouterInstance->bufferHandlers[featureNum] = NULL;
+#endif
+        setTickDeadline(featureRouterInstance, featureNum, 0);
         return RESULT_SUCCESS;
     } else {
         return RESULT_FAIL_INVALID_PARAMETER;
     }
 }
 
-void diypinball_featureRouter_receiveCAN(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessage_t* message) {
+diypinball_result_t diypinball_featureRouter_setViewHandler(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t featureType, diypinball_messageViewReceivedHandler viewHandler) {
+    if((featureType >= 16) || (featureRouterInstance->features[featureType] == NULL)) {
+        return RESULT_FAIL_INVALID_PARAMETER;
+    }
+
+    featureRouterInstance->viewHandlers[featureType] = viewHandler;
+
+    return RESULT_SUCCESS;
+}
+
+static uint8_t isAddressedToBoard(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t id) {
+    uint8_t address = (id & 0x00FF0000) >> 16;
+
+    if(id & 0x01000000) {
+        return address == featureRouterInstance->boardAddress;
+    }
+
+    if(address == DIYPINBALL_BROADCAST_ALL_BOARDS) {
+        return 1;
+    }
+
+    if(address <= DIYPINBALL_FEATUREROUTER_GROUP_COUNT) {
+        return (featureRouterInstance->groupMask >> (address - 1)) & 0x01;
+    }
+
+    return 0;
+}
+
+static void routeCANMessage(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessage_t* message) {
     diypinball_pinballMessage_t decodedMessage;
+    diypinball_featureHandlerInstance_t *feature;
+    diypinball_pinballMessageView_t view;
+
+    if(!isAddressedToBoard(featureRouterInstance, message->id)) {
+        return;
+    }
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    if(isSegmentFrame(message->id)) {
+        receiveSegmentFrame(featureRouterInstance, message);
+        return;
+    }
+#endif
+
+    view.message = message;
 
-    decodedMessage.priority = (message->id & 0x1E000000) >> 25;
-    decodedMessage.unitSpecific = (message->id & 0x01000000) >> 24;
-    decodedMessage.boardAddress = (message->id & 0x00FF0000) >> 16;
-    decodedMessage.featureType = (message->id & 0x0000F000) >> 12;
-    decodedMessage.featureNum = (message->id & 0x00000F00) >> 8;
-    decodedMessage.function = (message->id & 0x000000F0) >> 4;
-    decodedMessage.reserved = (message->id & 0x0000000F);
+    feature = featureRouterInstance->features[diypinball_pinballMessageView_getFeatureType(&view)];
+    if(feature == NULL) {
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+        STATISTICS(featureRouterInstance, MESSAGE_FEATURE_TYPE(message)).dropCount++;
+#endif
+        return;
+    }
 
-    if(message->rtr) {
-        decodedMessage.messageType = MESSAGE_REQUEST;
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    if(!(featureRouterInstance->viewHandlers[feature->featureType])) {
+        diypinball_featureRouter_decodeMessageView(&view, &decodedMessage);
+    }
+    dispatchTimed(featureRouterInstance, feature, &view, &decodedMessage);
+#else
+    if(featureRouterInstance->viewHandlers[feature->featureType]) {
+        (featureRouterInstance->viewHandlers[feature->featureType])(feature->concreteFeatureHandlerInstance, &view);
     } else {
-        decodedMessage.messageType = MESSAGE_COMMAND;
+        diypinball_featureRouter_decodeMessageView(&view, &decodedMessage);
+        (feature->messageHandler)(feature->concreteFeatureHandlerInstance, &decodedMessage);
+    }
+#endif
+
+    // the message may have changed the handler's timed work, let it re-evaluate on the next tick
+    setTickDeadline(featureRouterInstance, feature->featureType, 0);
+}
+
+void diypinball_featureRouter_receiveCAN(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessage_t* message) {
+    diypinball_featureRouter_beginBatch(featureRouterInstance);
+    routeCANMessage(featureRouterInstance, message);
+    diypinball_featureRouter_endBatch(featureRouterInstance);
+}
+
+diypinball_result_t diypinball_featureRouter_enqueueCAN(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessage_t* message) {
+    diypinball_featureRouterRxQueue_t *queue = &(featureRouterInstance->rxQueue);
+    uint8_t head = queue->head;
+    uint8_t depth = (uint8_t) (head - queue->tail);
+
+    if(depth >= DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE) {
+        queue->overflowCount++;
+        return RESULT_FAIL_QUEUE_FULL;
+    }
+
+    queue->messages[head & RX_QUEUE_MASK] = *message;
+    COMPILER_BARRIER();
+    queue->head = head + 1;
+
+    depth++;
+    if(depth > queue->highWaterMark) {
+        queue->highWaterMark = depth;
+    }
+
+    return RESULT_SUCCESS;
+}
+
+uint8_t diypinball_featureRouter_processPending(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    diypinball_featureRouterRxQueue_t *queue = &(featureRouterInstance->rxQueue);
+    uint8_t head = queue->head;
+    uint8_t tail = queue->tail;
+    uint8_t processed = 0;
+
+    COMPILER_BARRIER();
+
+    diypinball_featureRouter_beginBatch(featureRouterInstance);
+
+    // only drain what was queued on entry, so a busy bus can't starve the main loop
+    while(tail != head) {
+        diypinball_featureRouter_receiveCAN(featureRouterInstance, &(queue->messages[tail & RX_QUEUE_MASK]));
+        tail++;
+        COMPILER_BARRIER();
+        queue->tail = tail;
+        processed++;
+    }
+
+    diypinball_featureRouter_endBatch(featureRouterInstance);
+
+    return processed;
+}
+
+void diypinball_featureRouter_getRxQueueStatistics(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t *highWaterMark, uint32_t *overflowCount) {
+    *highWaterMark = featureRouterInstance->rxQueue.highWaterMark;
+    *overflowCount = featureRouterInstance->rxQueue.overflowCount;
+}
+
+diypinball_result_t diypinball_featureRouter_setTxQueueDepth(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t depth) {
+    diypinball_featureRouterTxQueue_t *queue = &(featureRouterInstance->txQueue);
+
+    if(depth > DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE) {
+        return RESULT_FAIL_INVALID_PARAMETER;
+    }
+
+    lockTxQueue(queue);
+    queue->dropCount += queue->count;
+    queue->count = 0;
+    queue->depth = depth;
+    unlockTxQueue(queue);
+
+    return RESULT_SUCCESS;
+}
+
+uint8_t diypinball_featureRouter_transmitNext(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    diypinball_featureRouterTxQueue_t *queue = &(featureRouterInstance->txQueue);
+
+    lockTxQueue(queue);
+
+    if(queue->count == 0) {
+        unlockTxQueue(queue);
+        return 0;
+    }
+
+    // still locked, so a message queued meanwhile can't take the slot before it's sent
+    queue->count--;
+    transmitCANMessage(featureRouterInstance, &(queue->messages[queue->count]));
+
+    unlockTxQueue(queue);
+
+    return 1;
+}
+
+void diypinball_featureRouter_setTxQueueLockHandlers(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_featureRouterTxQueueLockHandler lockHandler, diypinball_featureRouterTxQueueLockHandler unlockHandler) {
+    featureRouterInstance->txQueue.lockHandler = lockHandler;
+    featureRouterInstance->txQueue.unlockHandler = unlockHandler;
+}
+
+void diypinball_featureRouter_setCanSendBatchHandler(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canMessageSendBatchHandler canSendBatchHandler) {
+    featureRouterInstance->canSendBatchHandler = canSendBatchHandler;
+}
+
+uint8_t diypinball_featureRouter_getTxQueueSpace(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    diypinball_featureRouterTxQueue_t *queue = &(featureRouterInstance->txQueue);
+    uint8_t space;
+
+    if(!queue->depth) {
+        return 0xFF;
     }
-    decodedMessage.dataLength = message->dlc;
-    memcpy(decodedMessage.data, message->data, 8);
 
-    if(featureRouterInstance->features[decodedMessage.featureType] != NULL) {
-        (featureRouterInstance->features[decodedMessage.featureType]->messageHandler)(featureRouterInstance->features[decodedMessage.featureType]->concreteFeatureHandlerInstance, &decodedMessage);
+    lockTxQueue(queue);
+    space = (queue->count < queue->depth) ? (uint8_t) (queue->depth - queue->count) : 0;
+    unlockTxQueue(queue);
+
+    return space;
+}
+
+void diypinball_featureRouter_getTxQueueStatistics(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t *peakCount, uint32_t *dropCount) {
+    *peakCount = featureRouterInstance->txQueue.peakCount;
+    *dropCount = featureRouterInstance->txQueue.dropCount;
+}
+
+void diypinball_featureRouter_setGroupMask(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t groupMask) {
+    featureRouterInstance->groupMask = groupMask;
+}
+
+uint32_t diypinball_featureRouter_getGroupMask(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    return featureRouterInstance->groupMask;
+}
+
+void diypinball_featureRouter_beginBatch(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    if(featureRouterInstance->canSendBatchHandler) {
+        featureRouterInstance->txBatch.openCount++;
     }
 }
 
+void diypinball_featureRouter_endBatch(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    if(featureRouterInstance->txBatch.openCount) {
+        featureRouterInstance->txBatch.openCount--;
+        if(featureRouterInstance->txBatch.openCount == 0) {
+            flushTxBatch(featureRouterInstance);
+        }
+    }
+}
+
+void diypinball_featureRouter_decodeMessageView(const diypinball_pinballMessageView_t *view, diypinball_pinballMessage_t *message) {
+    message->priority = diypinball_pinballMessageView_getPriority(view);
+    message->unitSpecific = diypinball_pinballMessageView_getUnitSpecific(view);
+    message->boardAddress = diypinball_pinballMessageView_getBoardAddress(view);
+    message->featureType = diypinball_pinballMessageView_getFeatureType(view);
+    message->featureNum = diypinball_pinballMessageView_getFeatureNum(view);
+    message->function = diypinball_pinballMessageView_getFunction(view);
+    message->reserved = diypinball_pinballMessageView_getReserved(view);
+    message->messageType = diypinball_pinballMessageView_getMessageType(view);
+    message->dataLength = diypinball_pinballMessageView_getDataLength(view);
+    memcpy(message->data, view->message->data, DIYPINBALL_MAX_DATA_LENGTH);
+}
+
 void diypinball_featureRouter_getFeatureBitmap(diypinball_featureRouterInstance_t *featureRouterInstance, uint16_t *bitmap) {
     uint8_t i;
 
@@ -77,42 +880,239 @@ void diypinball_featureRouter_getFeatureBitmap(diypinball_featureRouterInstance_
     }
 }
 
-void diypinball_featureRouter_millisecondTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum) {
+uint8_t diypinball_featureRouter_getAcceptanceFilters(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_canFilter_t *filters, uint8_t maxFilters) {
+    uint16_t bitmap;
+    uint8_t blockStart[16], blockSize[16];
+    uint8_t numBlocks = 0;
+    uint8_t start = 0;
+    uint8_t size, i;
+    uint32_t featureMask;
+    uint32_t boardId = 0x01000000 | (featureRouterInstance->boardAddress << 16);
+
+    diypinball_featureRouter_getFeatureBitmap(featureRouterInstance, &bitmap);
+
+    // cover the implemented feature types with the fewest aligned power-of-two blocks
+    while(start < 16) {
+        if(!(bitmap & (1 << start))) {
+            start++;
+            continue;
+        }
+        size = 1;
+        while(((start % (size * 2)) == 0) && ((start + (size * 2)) <= 16) &&
+            (((bitmap >> start) & ((1 << (size * 2)) - 1)) == ((1 << (size * 2)) - 1))) {
+            size *= 2;
+        }
+        blockStart[numBlocks] = start;
+        blockSize[numBlocks] = size;
+        numBlocks++;
+        start += size;
+    }
+
+    if((numBlocks * 2) <= maxFilters) {
+        for(i = 0; i < numBlocks; i++) {
+            featureMask = (0x0F & ~(blockSize[i] - 1)) << 12;
+            filters[i * 2].id = boardId | (blockStart[i] << 12);
+            filters[i * 2].mask = 0x01FF0000 | featureMask;
+            filters[(i * 2) + 1].id = (blockStart[i] << 12);
+            filters[(i * 2) + 1].mask = 0x01000000 | featureMask;
+        }
+        return numBlocks * 2;
+    } else if(maxFilters >= 2) {
+        filters[0].id = boardId;
+        filters[0].mask = 0x01FF0000;
+        filters[1].id = 0;
+        filters[1].mask = 0x01000000;
+        return 2;
+    } else if(maxFilters == 1) {
+        filters[0].id = 0;
+        filters[0].mask = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+static uint32_t distributeTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum) {
     uint8_t i;
+    uint16_t dueMask = 0;
+    uint32_t delay;
+
+    featureRouterInstance->currentTick = tickNum;
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    serviceSegments(featureRouterInstance, tickNum);
+#endif
+
+    if(!(featureRouterInstance->tickPendingMask) || !TICK_REACHED(tickNum, featureRouterInstance->nextTickDeadline)) {
+        return diypinball_featureRouter_getTicksUntilDeadline(featureRouterInstance, tickNum);
+    }
 
     for(i = 0; i < 16; i++) {
-        if(featureRouterInstance->features[i]) {
-            (featureRouterInstance->features[i]->tickHandler)(featureRouterInstance->features[i]->concreteFeatureHandlerInstance, tickNum);
+        if((featureRouterInstance->tickPendingMask & (1 << i)) && TICK_REACHED(tickNum, featureRouterInstance->tickDeadlines[i])) {
+            dueMask |= (1 << i);
+        }
+    }
+    featureRouterInstance->tickPendingMask &= ~dueMask;
+
+    for(i = 0; i < 16; i++) {
+        if((dueMask & (1 << i)) && featureRouterInstance->features[i]) {
+            delay = (featureRouterInstance->features[i]->tickHandler)(featureRouterInstance->features[i]->concreteFeatureHandlerInstance, tickNum);
+            if(delay != DIYPINBALL_TICK_NONE) {
+                setTickDeadline(featureRouterInstance, i, delay);
+            }
+        }
+    }
+
+    updateNextTickDeadline(featureRouterInstance);
+
+    return diypinball_featureRouter_getTicksUntilDeadline(featureRouterInstance, tickNum);
+}
+
+uint32_t diypinball_featureRouter_millisecondTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum) {
+    uint32_t delay;
+
+    diypinball_featureRouter_beginBatch(featureRouterInstance);
+    delay = distributeTick(featureRouterInstance, tickNum);
+    diypinball_featureRouter_endBatch(featureRouterInstance);
+
+    return delay;
+}
+
+uint32_t diypinball_featureRouter_getTicksUntilDeadline(diypinball_featureRouterInstance_t* featureRouterInstance, uint32_t tickNum) {
+    uint32_t delay = DIYPINBALL_TICK_NONE;
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    uint32_t segmentDelay;
+#endif
+
+    if(featureRouterInstance->tickPendingMask) {
+        if(TICK_REACHED(tickNum, featureRouterInstance->nextTickDeadline)) {
+            delay = 0;
+        } else {
+            delay = featureRouterInstance->nextTickDeadline - tickNum;
         }
     }
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+    segmentDelay = getSegmentTicksUntilDeadline(featureRouterInstance, tickNum);
+    if(segmentDelay < delay) {
+        delay = segmentDelay;
+    }
+#endif
+
+    return delay;
+}
+
+void diypinball_featureRouter_scheduleTick(diypinball_featureRouterInstance_t* featureRouterInstance, uint8_t featureType, uint32_t delay) {
+    if((featureType < 16) && featureRouterInstance->features[featureType]) {
+        setTickDeadline(featureRouterInstance, featureType, delay);
+    }
+}
+
+uint32_t diypinball_featureRouter_getTick(diypinball_featureRouterInstance_t* featureRouterInstance) {
+    return readCurrentTick(featureRouterInstance);
+}
+
+void diypinball_featureRouter_setTickSourceHandler(diypinball_featureRouterInstance_t* featureRouterInstance, diypinball_featureRouterTickSourceHandler tickSourceHandler) {
+    featureRouterInstance->tickSourceHandler = tickSourceHandler;
 }
 
 void diypinball_featureRouter_sendPinballMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *message) {
     diypinball_canMessage_t encodedMessage;
 
-    uint8_t boardAddress = 0;
+    encodePinballMessage(featureRouterInstance, message, &encodedMessage);
 
-    if(message->messageType == MESSAGE_RESPONSE) {
-        boardAddress = featureRouterInstance->boardAddress;
-        encodedMessage.rtr = 0;
-    } else if(message->messageType == MESSAGE_COMMAND) {
-        boardAddress = message->boardAddress;
-        encodedMessage.rtr = 0;
-    } else if(message->messageType == MESSAGE_REQUEST) {
-        boardAddress = message->boardAddress;
-        encodedMessage.rtr = 1;
+    sendCANMessage(featureRouterInstance, &encodedMessage);
+}
+
+void diypinball_featureRouter_encodePinballMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *message, diypinball_canMessage_t *encodedMessage) {
+    encodePinballMessage(featureRouterInstance, message, encodedMessage);
+}
+
+void diypinball_featureRouter_sendCANMessage(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_canMessage_t *message) {
+    sendCANMessage(featureRouterInstance, message);
+}
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+diypinball_result_t diypinball_featureRouter_sendPinballBuffer(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_pinballMessage_t *header, const uint8_t *buffer, uint16_t length) {
+    diypinball_featureRouterSegmentTx_t *segmentTx = &(featureRouterInstance->segmentTx);
+    diypinball_pinballMessage_t message;
+    diypinball_canMessage_t firstFrame;
+
+    if((header->messageType == MESSAGE_REQUEST) || (length > DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE)) {
+        return RESULT_FAIL_INVALID_PARAMETER;
     }
 
-    encodedMessage.id = ((message->priority & 0x0f) << 25) | 
-                        ((message->unitSpecific & 0x01) << 24) | 
-                        (boardAddress << 16) | 
-                        ((message->featureType & 0x0f) << 12) | 
-                        ((message->featureNum & 0x0f) << 8) | 
-                        ((message->function & 0x0f) << 4) | 
-                        (message->reserved & 0x0f);
+    if(length <= DIYPINBALL_MAX_DATA_LENGTH) {
+        message = *header;
+        memcpy(message.data, buffer, length);
+        message.dataLength = length;
+        diypinball_featureRouter_sendPinballMessage(featureRouterInstance, &message);
+        return RESULT_SUCCESS;
+    }
+
+    if(segmentTx->length || isTxQueueFull(featureRouterInstance)) {
+        return RESULT_FAIL_QUEUE_FULL;
+    }
+
+    encodePinballMessage(featureRouterInstance, header, &firstFrame);
+
+    segmentTx->id = firstFrame.id & SEGMENT_ID_MASK;
+    segmentTx->length = length;
+    memcpy(segmentTx->buffer, buffer, length);
+    segmentTx->sent = DIYPINBALL_MAX_DATA_LENGTH - 2;
+    segmentTx->sequence = 1;
+    segmentTx->waiting = 1;
+    segmentTx->blockRemaining = 0;
+    segmentTx->separationTime = 0;
+    segmentTx->lastTick = featureRouterInstance->currentTick;
 
-    encodedMessage.dlc = message->dataLength;
-    memcpy(encodedMessage.data, message->data, 8);
+    firstFrame.id = segmentTx->id | DIYPINBALL_SEGMENT_FIRST_FRAME;
+    firstFrame.dlc = diypinball_lengthToDlc(DIYPINBALL_MAX_DATA_LENGTH);
+    firstFrame.data[0] = (uint8_t) (length & 0xFF);
+    firstFrame.data[1] = (uint8_t) (length >> 8);
+    memcpy(&(firstFrame.data[2]), buffer, DIYPINBALL_MAX_DATA_LENGTH - 2);
 
-    return featureRouterInstance->canSendHandler(&encodedMessage);
-}
\ No newline at end of file
+    sendCANMessage(featureRouterInstance, &firstFrame);
+
+    return RESULT_SUCCESS;
+}
+
+void diypinball_featureRouter_setSegmentFlowControl(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t blockSize, uint8_t separationTime) {
+    featureRouterInstance->segmentRx.blockSize = blockSize;
+    featureRouterInstance->segmentRx.separationTime = separationTime;
+}
+
+diypinball_result_t diypinball_featureRouter_setBufferHandler(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType, diypinball_bufferReceivedHandler bufferHandler) {
+    if((featureType >= 16) || (featureRouterInstance->features[featureType] == NULL)) {
+        return RESULT_FAIL_INVALID_PARAMETER;
+    }
+
+    featureRouterInstance->bufferHandlers[featureType] = bufferHandler;
+
+    return RESULT_SUCCESS;
+}
+#endif
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+void diypinball_featureRouter_setCycleCounterHandler(diypinball_featureRouterInstance_t *featureRouterInstance, diypinball_featureRouterCycleCounterHandler cycleCounterHandler) {
+    featureRouterInstance->cycleCounterHandler = cycleCounterHandler;
+}
+
+diypinball_result_t diypinball_featureRouter_getStatistics(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType, diypinball_featureStatistics_t *statistics) {
+    if(featureType >= 16) {
+        return RESULT_FAIL_INVALID_PARAMETER;
+    }
+
+    *statistics = featureRouterInstance->statistics[featureType];
+
+    return RESULT_SUCCESS;
+}
+
+void diypinball_featureRouter_resetStatistics(diypinball_featureRouterInstance_t *featureRouterInstance) {
+    resetStatistics(featureRouterInstance);
+}
+
+void diypinball_featureRouter_reportUnknownFunction(diypinball_featureRouterInstance_t *featureRouterInstance, uint8_t featureType) {
+    STATISTICS(featureRouterInstance, featureType).unknownFunctionCount++;
+}
+#endif
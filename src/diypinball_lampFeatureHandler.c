@@ -111,6 +111,16 @@ static void setAllLamps(diypinball_lampFeatureHandlerInstance_t *instance, diypi
         return;
     }
 
+#if DIYPINBALL_CAN_FD
+    // a CAN FD frame can carry both banks at once
+    if(message->dataLength > 8) {
+        lampMax = lampBase + message->dataLength - 1;
+        if(lampMax > 15) {
+            lampMax = 15;
+        }
+    }
+#endif
+
     if(lampBase > instance->numLamps) {
         return;
     }
@@ -159,8 +169,8 @@ void diypinball_lampFeatureHandler_init(diypinball_lampFeatureHandlerInstance_t
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_lampFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
-    
+uint32_t diypinball_lampFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+    return DIYPINBALL_TICK_NONE;
 }
 
 void diypinball_lampFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -178,7 +188,9 @@ void diypinball_lampFeatureHandler_messageReceivedHandler(void *instance, diypin
         if(message->messageType == MESSAGE_COMMAND) {
             setAllLamps(typedInstance, message);
         }
+        break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 }
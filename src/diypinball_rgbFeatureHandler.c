@@ -56,6 +56,16 @@ static void setAllRGBs(diypinball_rgbFeatureHandlerInstance_t *instance, diypinb
         rgbMax = 7;
     }
 
+#if DIYPINBALL_CAN_FD
+    // a CAN FD frame can carry both banks of a colour at once
+    if(message->dataLength > 8) {
+        rgbMax = rgbBase + message->dataLength - 1;
+        if(rgbMax > 15) {
+            rgbMax = 15;
+        }
+    }
+#endif
+
     if(rgbBase > instance->numRGBs) {
         return;
     }
@@ -103,8 +113,8 @@ void diypinball_rgbFeatureHandler_init(diypinball_rgbFeatureHandlerInstance_t *i
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_rgbFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
-    
+uint32_t diypinball_rgbFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+    return DIYPINBALL_TICK_NONE;
 }
 
 void diypinball_rgbFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -122,7 +132,9 @@ void diypinball_rgbFeatureHandler_messageReceivedHandler(void *instance, diypinb
         if(message->messageType == MESSAGE_COMMAND) {
             setAllRGBs(typedInstance, message);
         }
+        break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 }
@@ -15,14 +15,14 @@ static void sendDisplay(diypinball_scoreFeatureHandlerInstance_t* instance, diyp
     response.reserved = 0x00;
     response.messageType = MESSAGE_RESPONSE;
 
-    response.dataLength = 8;
+    response.dataLength = DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH;
 
-    memcpy(response.data, instance->display, 8);
+    memcpy(response.data, instance->display, DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH);
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
 static void setDisplay(diypinball_scoreFeatureHandlerInstance_t* instance, diypinball_pinballMessage_t* message) {
-    memset(instance->display, 0x00, 8);
+    memset(instance->display, 0x00, DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH);
     memcpy(instance->display, message->data, message->dataLength);
     instance->displayChangedHandler(instance->display);
 }
@@ -61,7 +61,7 @@ void diypinball_scoreFeatureHandler_init(diypinball_scoreFeatureHandlerInstance_
     instance->brightnessChangedHandler = init->brightnessChangedHandler;
 
     uint8_t i;
-    for(i=0; i<8; i++) {
+    for(i=0; i<DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH; i++) {
         instance->display[i] = 0x00;
     }
 
@@ -73,8 +73,8 @@ void diypinball_scoreFeatureHandler_init(diypinball_scoreFeatureHandlerInstance_
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_scoreFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
-    
+uint32_t diypinball_scoreFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+    return DIYPINBALL_TICK_NONE;
 }
 
 void diypinball_scoreFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -94,7 +94,9 @@ void diypinball_scoreFeatureHandler_messageReceivedHandler(void *instance, diypi
         } else {
             setBrightness(typedInstance, message);
         }
+        break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 }
@@ -111,7 +113,7 @@ void diypinball_scoreFeatureHandler_deinit(diypinball_scoreFeatureHandlerInstanc
     instance->brightnessChangedHandler = NULL;
 
     uint8_t i;
-    for(i=0; i<8; i++) {
+    for(i=0; i<DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH; i++) {
         instance->display[i] = 0x00;
     }
 }
@@ -1,299 +1,1512 @@
 #include "diypinball.h"
 #include "diypinball_featureRouter.h"
+#include "diypinball_coilEnvelopeGenerator.h"
 #include "diypinball_switchFeatureHandler.h"
 
-static void fireRule(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t rule) {
-    diypinball_pinballMessage_t command;
-    diypinball_switchRule_t activeRule;
-    uint8_t ruleMask;
+#include <string.h>
 
-    if(switchNum >= instance->numSwitches) {
-        return;
+// wraparound-safe check that tick has reached deadline
+#define POLL_REACHED(tick, deadline) ((int32_t) ((uint32_t) (tick) - (uint32_t) (deadline)) >= 0)
+
+static uint16_t switchBit(uint8_t switchNum) {
+    return (uint16_t) (1U << (switchNum & 0x0F));
+}
+
+static uint8_t switchBank(uint8_t switchNum) {
+    return switchNum >> 4;
+}
+
+// switches past the first bank carry their bank in bits 0-2 of the reserved field
+static uint8_t messageSwitchNum(diypinball_pinballMessage_t *message) {
+    return (uint8_t) (((message->reserved & 0x07) << 4) | (message->featureNum & 0x0F));
+}
+
+static uint8_t bankCount(diypinball_switchFeatureHandlerInstance_t *instance) {
+    return (uint8_t) ((instance->numSwitches + 15) >> 4);
+}
+
+static uint16_t validSwitchMask(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank) {
+    uint8_t first = (uint8_t) (bank << 4);
+
+    if(instance->numSwitches <= first) {
+        return 0;
+    }
+    if((instance->numSwitches - first) >= 16) {
+        return 0xFFFF;
+    }
+
+    return (uint16_t) ((1U << (instance->numSwitches - first)) - 1);
+}
+
+static uint8_t lowestSetBit(uint16_t bits) {
+    uint8_t switchNum = 0;
+
+    while(!(bits & 0x0001)) {
+        bits >>= 1;
+        switchNum++;
     }
 
-    activeRule = rule ? instance->switches[switchNum].closeRule : instance->switches[switchNum].openRule;
-    ruleMask = rule ? 0x02 : 0x01;
+    return switchNum;
+}
 
-    if(!(instance->switches[switchNum].ruleMask & ruleMask)) {
-        return;
+// read the given switches of a bank, in one call when the platform can read a whole bank
+static uint16_t readSwitchStates(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t switches) {
+    uint16_t states = 0;
+    uint8_t switchNum;
+    uint8_t newState;
+
+    if(instance->readAllStatesHandler) {
+        (instance->readAllStatesHandler)(&states, bank);
+        return states & switches;
+    }
+
+    while(switches) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(switches));
+        switches &= (uint16_t) (switches - 1);
+
+        (instance->readStateHandler)(&newState, switchNum);
+        if(newState) {
+            states |= switchBit(switchNum);
+        }
+    }
+
+    return states;
+}
+
+static uint32_t captureTimestamp(diypinball_switchFeatureHandlerInstance_t *instance) {
+    return instance->timestampHandler ? (instance->timestampHandler)() : 0;
+}
+
+static void packTimestamp(uint8_t *data, uint32_t timestamp) {
+    data[0] = (uint8_t) (timestamp & 0xFF);
+    data[1] = (uint8_t) ((timestamp >> 8) & 0xFF);
+    data[2] = (uint8_t) ((timestamp >> 16) & 0xFF);
+    data[3] = (uint8_t) (timestamp >> 24);
+}
+
+// a report already filling a classic CAN frame gives up its last byte, the top of the timestamp
+static void appendJournalSequence(diypinball_pinballMessage_t *response, uint8_t sequence) {
+    if(response->dataLength >= DIYPINBALL_MAX_DATA_LENGTH) {
+        response->dataLength = DIYPINBALL_MAX_DATA_LENGTH - 1;
+    }
+
+    response->data[response->dataLength] = sequence;
+    response->dataLength++;
+}
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+static void clearStatistics(diypinball_switchStatus_t *status) {
+    status->statistics.activationCount = 0;
+    status->statistics.bounceCount = 0;
+    status->statistics.minClosedTime = DIYPINBALL_SWITCHSTATISTICS_NO_TIME;
+    status->statistics.minOpenTime = DIYPINBALL_SWITCHSTATISTICS_NO_TIME;
+    status->transitionTick = 0;
+}
+
+static void countTransition(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t state, uint32_t tick) {
+    diypinball_switchStatus_t *status = &(instance->switches[switchNum]);
+    uint32_t duration = tick - status->transitionTick;
+    uint16_t *minTime = NULL;
+
+    if(state) {
+        // the open period before the first close started at power-up, not at an edge
+        if(status->statistics.activationCount) {
+            minTime = &(status->statistics.minOpenTime);
+        }
+        if(status->statistics.activationCount < 0xFFFF) {
+            status->statistics.activationCount++;
+        }
+    } else {
+        minTime = &(status->statistics.minClosedTime);
+    }
+
+    if(minTime && (duration < *minTime)) {
+        *minTime = (uint16_t) duration;
+    }
+
+    status->transitionTick = tick;
+}
+#endif
+
+static void sendSwitchFault(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t fault, uint8_t state) {
+    diypinball_pinballMessage_t response;
+
+    response.priority = instance->switches[switchNum].reportPriority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x0D;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    // 2 bytes of data tells it apart from the 3 byte fault limits readback
+    response.dataLength = 2;
+    response.data[0] = fault;
+    response.data[1] = state;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void scheduleStuckCheck(diypinball_switchFeatureHandlerInstance_t *instance, uint32_t tick) {
+    uint32_t deadline = tick + ((uint32_t) instance->stuckLimit * 100);
+
+    if(!instance->stuckCheckPending || POLL_REACHED(instance->nextStuckTick, deadline)) {
+        instance->nextStuckTick = deadline;
+        instance->stuckCheckPending = 1;
+        diypinball_featureRouter_scheduleTick(instance->featureHandlerInstance.routerInstance, instance->featureHandlerInstance.featureType, deadline - tick);
+    }
+}
+
+// every accepted transition is journaled ahead of its report, so the report can carry its sequence number
+static void journalTransitions(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t changed, uint16_t states) {
+    diypinball_switchJournalEntry_t *entry;
+    uint8_t switchNum;
+
+    while(changed) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(changed));
+        changed &= (uint16_t) (changed - 1);
+
+        instance->journalSequence++;
+        instance->switches[switchNum].journalSequence = instance->journalSequence;
+
+        entry = &(instance->journal[instance->journalHead]);
+        entry->sequence = instance->journalSequence;
+        entry->switchNum = switchNum;
+        entry->state = (states & switchBit(switchNum)) ? 1 : 0;
+        entry->eventTime = instance->switches[switchNum].eventTime;
+
+        instance->journalHead = (instance->journalHead + 1) & (DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE - 1);
+        if(instance->journalCount < DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE) {
+            instance->journalCount++;
+        }
+    }
+}
+
+// every accepted transition passes through here, whichever path registered it
+static void recordTransitions(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t changed, uint16_t states) {
+    uint32_t tick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+    uint8_t switchNum;
+
+    while(changed) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(changed));
+        changed &= (uint16_t) (changed - 1);
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+        countTransition(instance, switchNum, (states & switchBit(switchNum)) ? 1 : 0, tick);
+#endif
+
+        if(states & switchBit(switchNum)) {
+            instance->switches[switchNum].closeTick = tick;
+            if(instance->stuckLimit) {
+                scheduleStuckCheck(instance, tick);
+            }
+        } else if(instance->stuckMask[bank] & switchBit(switchNum)) {
+            instance->stuckMask[bank] &= (uint16_t) ~switchBit(switchNum);
+            sendSwitchFault(instance, switchNum, DIYPINBALL_SWITCHFAULT_NONE, 0);
+        }
     }
+}
+
+static void encodeRule(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchRule_t *rule) {
+    diypinball_pinballMessage_t command;
 
     command.priority = 0x01;
-    command.boardAddress = activeRule.boardAddress;
+    command.boardAddress = rule->boardAddress;
     command.unitSpecific = 0x01;
     command.featureType = 0x03;
-    command.featureNum = activeRule.solenoidNum;
+    command.featureNum = rule->solenoidNum;
     command.function = 0x00;
     command.reserved = 0x00;
     command.messageType = MESSAGE_COMMAND;
 
+    memset(command.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
     command.dataLength = 4;
-    command.data[0] = activeRule.attackStatus;
-    command.data[1] = activeRule.attackDuration;
-    command.data[2] = activeRule.sustainStatus;
-    command.data[3] = activeRule.sustainDuration;
+    command.data[0] = rule->attackStatus;
+    command.data[1] = rule->attackDuration;
+    command.data[2] = rule->sustainStatus;
+    command.data[3] = rule->sustainDuration;
 
-    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &command);
+    diypinball_featureRouter_encodePinballMessage(instance->featureHandlerInstance.routerInstance, &command, &(rule->frame));
+}
+
+static void clearRule(diypinball_switchRule_t *rule) {
+    rule->boardAddress = 0;
+    rule->solenoidNum = 0;
+    rule->attackStatus = 0;
+    rule->attackDuration = 0;
+    rule->sustainStatus = 0;
+    rule->sustainDuration = 0;
+    rule->frame.id = 0;
+    rule->frame.rtr = 0;
+    rule->frame.dlc = 0;
+    memset(rule->frame.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
+    rule->cooldown = 0;
+    rule->lastFireTick = 0;
+    rule->suppressedCount = 0;
+}
+
+// deliver a coil command for one of this board's own coils without a trip over the bus, returns 1 if delivered
+static uint8_t fireLocalCoil(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t boardAddress, uint8_t coilNum, diypinball_coilStatus_t *status) {
+    if(!instance->localCoils || (boardAddress != instance->featureHandlerInstance.routerInstance->boardAddress)) {
+        return 0;
+    }
+
+    diypinball_coilEnvelopeGenerator_setCoilState(instance->localCoils, coilNum, status);
+
+    return 1;
+}
+
+static uint8_t fireLocalRule(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchRule_t *rule, uint8_t activate) {
+    diypinball_coilStatus_t status;
+
+    status.attackState = activate ? rule->attackStatus : 0;
+    status.attackDuration = activate ? rule->attackDuration : 0;
+    status.sustainState = activate ? rule->sustainStatus : 0;
+    status.sustainDuration = activate ? rule->sustainDuration : 0;
+
+    return fireLocalCoil(instance, rule->boardAddress, rule->solenoidNum, &status);
+}
+
+static void fireRule(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t rule) {
+    diypinball_switchRule_t *activeRule;
+    uint32_t tick;
+    uint16_t ruleMask;
+
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    ruleMask = rule ? instance->closeRuleMask[switchBank(switchNum)] : instance->openRuleMask[switchBank(switchNum)];
+
+    if(!(ruleMask & switchBit(switchNum))) {
+        return;
+    }
+
+    activeRule = rule ? &(instance->switches[switchNum].closeRule) : &(instance->switches[switchNum].openRule);
+
+    // a re-triggering switch must not machine-gun its coil
+    if(activeRule->cooldown) {
+        tick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+        if((tick - activeRule->lastFireTick) < activeRule->cooldown) {
+            if(activeRule->suppressedCount < 0xFFFF) {
+                activeRule->suppressedCount++;
+            }
+            return;
+        }
+        activeRule->lastFireTick = tick;
+    }
+
+    if(fireLocalRule(instance, activeRule, 1) && !instance->announceLocalRules) {
+        return;
+    }
+
+    diypinball_featureRouter_sendCANMessage(instance->featureHandlerInstance.routerInstance, &(activeRule->frame));
 }
 
 static void fireDeactivationRule(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t rule) {
-    diypinball_pinballMessage_t command;
-    diypinball_switchRule_t activeRule;
-    uint8_t ruleMask;
+    diypinball_switchRule_t *activeRule;
+    diypinball_canMessage_t frame;
+    uint16_t ruleMask;
 
-    if(switchNum > instance->numSwitches) {
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    ruleMask = rule ? instance->closeRuleMask[switchBank(switchNum)] : instance->openRuleMask[switchBank(switchNum)];
+
+    if(!(ruleMask & switchBit(switchNum))) {
         return;
     }
 
-    activeRule = rule ? instance->switches[switchNum].closeRule : instance->switches[switchNum].openRule;
-    ruleMask = rule ? 0x02 : 0x01;
+    activeRule = rule ? &(instance->switches[switchNum].closeRule) : &(instance->switches[switchNum].openRule);
 
-    if(!(instance->switches[switchNum].ruleMask & ruleMask)) {
+    if(fireLocalRule(instance, activeRule, 0) && !instance->announceLocalRules) {
         return;
     }
 
+    // same solenoid as the activation frame, but turned off
+    frame = activeRule->frame;
+    memset(frame.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
+    frame.dlc = 1;
+
+    diypinball_featureRouter_sendCANMessage(instance->featureHandlerInstance.routerInstance, &frame);
+}
+
+static void runAction(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t actionNum) {
+    diypinball_switchAction_t *action = &(instance->actions[actionNum]);
+    diypinball_pinballMessage_t command;
+    diypinball_coilStatus_t status;
+
     command.priority = 0x01;
-    command.boardAddress = activeRule.boardAddress;
+    command.boardAddress = action->boardAddress;
     command.unitSpecific = 0x01;
-    command.featureType = 0x03;
-    command.featureNum = activeRule.solenoidNum;
+    command.featureNum = action->targetNum;
     command.function = 0x00;
     command.reserved = 0x00;
     command.messageType = MESSAGE_COMMAND;
 
-    command.dataLength = 1;
-    command.data[0] = 0x00;
+    memset(command.data, 0, DIYPINBALL_MAX_DATA_LENGTH);
+    command.dataLength = 4;
+    command.data[0] = action->params[0];
+    command.data[1] = action->params[1];
+    command.data[2] = action->params[2];
+    command.data[3] = action->params[3];
+
+    switch(action->type) {
+    case DIYPINBALL_SWITCHACTION_COIL:
+        command.featureType = 0x03;
+        status.attackState = action->params[0];
+        status.attackDuration = action->params[1];
+        status.sustainState = action->params[2];
+        status.sustainDuration = action->params[3];
+        if(fireLocalCoil(instance, action->boardAddress, action->targetNum, &status) && !instance->announceLocalRules) {
+            return;
+        }
+        break;
+    case DIYPINBALL_SWITCHACTION_LAMP:
+        command.featureType = 0x02;
+        break;
+    case DIYPINBALL_SWITCHACTION_RGB:
+        command.featureType = 0x05;
+        command.dataLength = 3;
+        break;
+    case DIYPINBALL_SWITCHACTION_HOST:
+        // 4 bytes of data tells it apart from the 8 byte action table readback
+        command.featureType = 0x01;
+        command.featureNum = actionNum;
+        command.function = 0x09;
+        command.reserved = switchBank(action->switchNum);
+        command.messageType = MESSAGE_RESPONSE;
+        break;
+    default:
+        return;
+    }
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &command);
+}
+
+static void runActions(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t event, uint16_t states) {
+    diypinball_switchAction_t *action;
+    uint8_t guardState;
+    uint8_t i;
+
+    for(i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        action = &(instance->actions[i]);
+
+        if((action->type == DIYPINBALL_SWITCHACTION_NONE) || (action->switchNum != switchNum) || !(action->eventMask & event)) {
+            continue;
+        }
+
+        // guards see the states being registered, including other switches changing in the same batch -
+        // setSwitchAction only accepts guards in the action switch's bank, so states always covers them
+        if(action->guard & DIYPINBALL_SWITCHACTION_GUARD_ENABLE) {
+            guardState = (states & switchBit(action->guard & 0x0F)) ? DIYPINBALL_SWITCHACTION_GUARD_CLOSED : 0;
+            if(guardState != (action->guard & DIYPINBALL_SWITCHACTION_GUARD_CLOSED)) {
+                continue;
+            }
+        }
+
+        runAction(instance, i);
+    }
+}
+
+static void updateActionSwitchMask(diypinball_switchFeatureHandlerInstance_t *instance) {
+    uint8_t i;
+
+    for(i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; i++) {
+        instance->actionSwitchMask[i] = 0;
+    }
+
+    for(i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        if(instance->actions[i].type != DIYPINBALL_SWITCHACTION_NONE) {
+            instance->actionSwitchMask[switchBank(instance->actions[i].switchNum)] |= switchBit(instance->actions[i].switchNum);
+        }
+    }
+}
+
+static void clearAction(diypinball_switchAction_t *action) {
+    action->switchNum = 0;
+    action->eventMask = 0;
+    action->type = DIYPINBALL_SWITCHACTION_NONE;
+    action->targetNum = 0;
+    action->guard = 0;
+    action->boardAddress = 0;
+    action->params[0] = 0;
+    action->params[1] = 0;
+    action->params[2] = 0;
+    action->params[3] = 0;
+}
+
+static void sendSwitchUpdate(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t state, uint8_t priority) {
+    diypinball_pinballMessage_t response;
+    uint8_t lastState = (instance->switchState[switchBank(switchNum)] & switchBit(switchNum)) ? 1 : 0;
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x00;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 2;
+    response.data[0] = state;
+    if(state && !lastState) {
+        response.data[1] = 1;
+    } else if((!state) && lastState) {
+        response.data[1] = 2;
+    } else {
+        response.data[1] = 0;
+    }
+
+    if(instance->timestampHandler) {
+        response.dataLength = 6;
+        packTimestamp(&(response.data[2]), instance->switches[switchNum].eventTime);
+    }
+
+    if(instance->reportJournalSequence) {
+        appendJournalSequence(&response, instance->switches[switchNum].journalSequence);
+    }
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+    if(response.data[1] == 1) {
+        fireRule(instance, switchNum, 1);
+    } else if(response.data[1] == 2) {
+        fireRule(instance, switchNum, 0);
+    }
+}
+
+static void reportSwitchState(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t state, uint8_t priority) {
+    uint8_t bank = switchBank(switchNum);
+    uint16_t newBit = state ? switchBit(switchNum) : 0;
+    uint16_t changed = (instance->switchState[bank] & switchBit(switchNum)) ^ newBit;
+
+    journalTransitions(instance, bank, changed, newBit);
+    sendSwitchUpdate(instance, switchNum, state, priority);
+    recordTransitions(instance, bank, changed, newBit);
+
+    if(state) {
+        instance->switchState[bank] |= switchBit(switchNum);
+    } else {
+        instance->switchState[bank] &= (uint16_t) ~switchBit(switchNum);
+    }
+}
+
+// a report covering several switches goes out at the most urgent priority among them
+static uint8_t reportPriority(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t switches) {
+    uint8_t priority = 0x0F;
+    uint8_t switchNum;
+
+    while(switches) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(switches));
+        switches &= (uint16_t) (switches - 1);
+        if(instance->switches[switchNum].reportPriority < priority) {
+            priority = instance->switches[switchNum].reportPriority;
+        }
+    }
+
+    return priority;
+}
+
+static void sendDeltaReport(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint8_t priority) {
+    diypinball_pinballMessage_t response;
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = 0;
+    response.function = 0x07;
+    response.reserved = bank;
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 4;
+    response.data[0] = (uint8_t) (instance->pendingDeltaMask[bank] & 0xFF);
+    response.data[1] = (uint8_t) (instance->pendingDeltaMask[bank] >> 8);
+    response.data[2] = (uint8_t) (instance->switchState[bank] & 0xFF);
+    response.data[3] = (uint8_t) (instance->switchState[bank] >> 8);
+
+    if(instance->timestampHandler) {
+        response.dataLength = 8;
+        packTimestamp(&(response.data[4]), instance->deltaStartTime);
+    }
+
+    if(instance->reportJournalSequence) {
+        appendJournalSequence(&response, instance->journalSequence);
+    }
+
+    instance->pendingDeltaMask[bank] = 0;
+    instance->pendingDeltaBanks &= (uint8_t) ~(1U << bank);
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void flushDeltaReports(diypinball_switchFeatureHandlerInstance_t *instance) {
+    uint8_t bank;
+
+    for(bank = 0; bank < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; bank++) {
+        if(instance->pendingDeltaBanks & (1U << bank)) {
+            sendDeltaReport(instance, bank, reportPriority(instance, bank, instance->pendingDeltaMask[bank]));
+        }
+    }
+}
+
+static void requestDeltaReport(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t priority) {
+    uint8_t bank = 0;
+
+    // a request reports every bank in use, pending transitions or not
+    do {
+        sendDeltaReport(instance, bank, priority);
+        bank++;
+    } while(bank < bankCount(instance));
+}
+
+static void queueDeltaReport(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t changed, uint32_t timestamp) {
+    diypinball_featureRouterInstance_t *router = instance->featureHandlerInstance.routerInstance;
+
+    if(!instance->pendingDeltaBanks) {
+        instance->deltaStartTick = diypinball_featureRouter_getTick(router);
+        instance->deltaStartTime = timestamp;
+        diypinball_featureRouter_scheduleTick(router, instance->featureHandlerInstance.featureType, instance->deltaReportWindow);
+    }
+
+    instance->pendingDeltaMask[bank] |= changed;
+    instance->pendingDeltaBanks |= (uint8_t) (1U << bank);
+}
+
+static void updateNextPollTick(diypinball_switchFeatureHandlerInstance_t *instance) {
+    uint16_t remaining;
+    uint32_t deadline;
+    uint8_t switchNum;
+    uint8_t bank;
+    uint8_t first = 1;
+
+    for(bank = 0; bank < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; bank++) {
+        remaining = instance->pollingMask[bank];
+
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+
+            deadline = instance->switches[switchNum].lastTick + instance->switches[switchNum].pollingInterval;
+            if(first || POLL_REACHED(instance->nextPollTick, deadline)) {
+                instance->nextPollTick = deadline;
+                first = 0;
+            }
+        }
+    }
+}
+
+static void sendPollReport(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t polled, uint16_t states, uint32_t timestamp, uint8_t priority) {
+    diypinball_pinballMessage_t response;
+    uint16_t edges = (states ^ instance->switchState[bank]) & polled;
+    uint8_t switchNum;
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = 0;
+    response.function = 0x06;
+    response.reserved = bank;
+    response.messageType = MESSAGE_RESPONSE;
+
+    // an all-switch status with a mask of which switches it covers
+    response.dataLength = 4;
+    response.data[0] = (uint8_t) (states & 0xFF);
+    response.data[1] = (uint8_t) (states >> 8);
+    response.data[2] = (uint8_t) (polled & 0xFF);
+    response.data[3] = (uint8_t) (polled >> 8);
+
+    if(instance->timestampHandler) {
+        response.dataLength = 8;
+        packTimestamp(&(response.data[4]), timestamp);
+    }
+
+    journalTransitions(instance, bank, edges, states);
+
+    if(instance->reportJournalSequence) {
+        appendJournalSequence(&response, instance->journalSequence);
+    }
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+
+    recordTransitions(instance, bank, edges, states);
+
+    while(edges) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(edges));
+        edges &= (uint16_t) (edges - 1);
+        fireRule(instance, switchNum, (states & switchBit(switchNum)) ? 1 : 0);
+    }
+
+    instance->switchState[bank] = (instance->switchState[bank] & (uint16_t) ~polled) | states;
+}
+
+static void pollSwitchBank(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint32_t tickNum) {
+    uint16_t remaining = instance->pollingMask[bank];
+    uint16_t due = 0;
+    uint16_t states;
+    uint32_t timestamp;
+    uint8_t switchNum;
+    uint8_t newState;
+
+    while(remaining) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+        remaining &= (uint16_t) (remaining - 1);
+
+        if(POLL_REACHED(tickNum, instance->switches[switchNum].lastTick + instance->switches[switchNum].pollingInterval)) {
+            due |= switchBit(switchNum);
+            instance->switches[switchNum].lastTick = tickNum;
+        }
+    }
+
+    if(due && !(due & (uint16_t) (due - 1))) {
+        // a single switch keeps the per-switch status message
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(due));
+        newState = readSwitchStates(instance, bank, due) ? 1 : 0;
+        instance->switches[switchNum].eventTime = captureTimestamp(instance);
+
+        reportSwitchState(instance, switchNum, newState, instance->switches[switchNum].reportPriority);
+    } else if(due) {
+        states = readSwitchStates(instance, bank, due);
+        timestamp = captureTimestamp(instance);
+        remaining = due;
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+            instance->switches[switchNum].eventTime = timestamp;
+        }
+
+        sendPollReport(instance, bank, due, states, timestamp, reportPriority(instance, bank, due));
+    }
+}
+
+static void pollSwitches(diypinball_switchFeatureHandlerInstance_t *instance, uint32_t tickNum) {
+    uint8_t bank;
+
+    // switches due together are grouped per bank, one report page each
+    for(bank = 0; bank < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; bank++) {
+        if(instance->pollingBanks & (1U << bank)) {
+            pollSwitchBank(instance, bank, tickNum);
+        }
+    }
+
+    updateNextPollTick(instance);
+}
+
+static void sendSwitchStatus(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t newState;
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    newState = readSwitchStates(instance, switchBank(switchNum), switchBit(switchNum)) ? 1 : 0;
+    instance->switches[switchNum].eventTime = captureTimestamp(instance);
+
+    reportSwitchState(instance, switchNum, newState, message->priority);
+}
+
+static void sendSwitchPolling(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    diypinball_pinballMessage_t response;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    response.priority = message->priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x01;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 1;
+    response.data[0] = instance->switches[switchNum].pollingInterval;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setSwitchPolling(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(message->dataLength < 1) {
+        return;
+    }
+
+    instance->switches[switchNum].pollingInterval = message->data[0];
+    instance->switches[switchNum].lastTick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+
+    if(message->data[0]) {
+        instance->pollingMask[switchBank(switchNum)] |= switchBit(switchNum);
+    } else {
+        instance->pollingMask[switchBank(switchNum)] &= (uint16_t) ~switchBit(switchNum);
+    }
+
+    if(instance->pollingMask[switchBank(switchNum)]) {
+        instance->pollingBanks |= (uint8_t) (1U << switchBank(switchNum));
+    } else {
+        instance->pollingBanks &= (uint8_t) ~(1U << switchBank(switchNum));
+    }
+
+    updateNextPollTick(instance);
+}
+
+static void sendSwitchTriggering(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    diypinball_pinballMessage_t response;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    response.priority = message->priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x02;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 1;
+    response.data[0] = 0;
+    if(instance->closeTriggerMask[switchBank(switchNum)] & switchBit(switchNum)) response.data[0] |= 0x01;
+    if(instance->openTriggerMask[switchBank(switchNum)] & switchBit(switchNum)) response.data[0] |= 0x02;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setSwitchTriggering(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(message->dataLength < 1) {
+        return;
+    }
+
+    instance->closeTriggerMask[switchBank(switchNum)] &= (uint16_t) ~switchBit(switchNum);
+    instance->openTriggerMask[switchBank(switchNum)] &= (uint16_t) ~switchBit(switchNum);
+    if(message->data[0] & 0x01) instance->closeTriggerMask[switchBank(switchNum)] |= switchBit(switchNum);
+    if(message->data[0] & 0x02) instance->openTriggerMask[switchBank(switchNum)] |= switchBit(switchNum);
+}
+
+static void sendSwitchDebounce(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    diypinball_pinballMessage_t response;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    response.priority = message->priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x03;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 1;
+    response.data[0] = instance->switches[switchNum].debounceLimit;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setSwitchDebounce(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(message->dataLength < 1) {
+        return;
+    }
+
+    instance->switches[switchNum].debounceLimit = message->data[0];
+    (instance->debounceChangedHandler)(switchNum, message->data[0]);
+}
+
+static void sendSwitchReportPriority(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    diypinball_pinballMessage_t response;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    response.priority = message->priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x0E;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 1;
+    response.data[0] = instance->switches[switchNum].reportPriority;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setSwitchReportPriority(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    // the CAN priority field is only 4 bits wide
+    if((message->dataLength < 1) || (message->data[0] > 0x0F)) {
+        return;
+    }
+
+    instance->switches[switchNum].reportPriority = message->data[0];
+}
+
+static void sendSwitchRule(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message, uint8_t rule) {
+    diypinball_pinballMessage_t response;
+    diypinball_switchRule_t *activeRule;
+    uint16_t ruleMask;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    activeRule = rule ? &(instance->switches[switchNum].closeRule) : &(instance->switches[switchNum].openRule);
+    ruleMask = rule ? instance->closeRuleMask[switchBank(switchNum)] : instance->openRuleMask[switchBank(switchNum)];
+
+    response.priority = message->priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = rule ? 0x05 : 0x04;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 7;
+    response.data[0] = (ruleMask & switchBit(switchNum)) ? 1 : 0;
+    response.data[1] = activeRule->boardAddress;
+    response.data[2] = activeRule->solenoidNum;
+    response.data[3] = activeRule->attackStatus;
+    response.data[4] = activeRule->attackDuration;
+    response.data[5] = activeRule->sustainStatus;
+    response.data[6] = activeRule->sustainDuration;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setSwitchRule(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message, uint8_t rule) {
+    diypinball_switchRule_t *activeRule;
+    uint16_t *ruleMask;
+    uint8_t switchNum = messageSwitchNum(message);
+
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(message->dataLength == 0) {
+        return;
+    }
+
+    if((message->data[0]) && (message->dataLength < 5)) {
+        // not enough data for rule
+        return;
+    }
+
+    activeRule = rule ? &(instance->switches[switchNum].closeRule) : &(instance->switches[switchNum].openRule);
+    ruleMask = rule ? &(instance->closeRuleMask[switchBank(switchNum)]) : &(instance->openRuleMask[switchBank(switchNum)]);
+
+    // if an existing rule is there (mask is set), send a deactivation message to that solenoid
+    if(*ruleMask & switchBit(switchNum)) {
+        fireDeactivationRule(instance, switchNum, rule);
+    }
+
+    *ruleMask &= (uint16_t) ~switchBit(switchNum);
+    *ruleMask |= message->data[0] ? switchBit(switchNum) : 0;
+    activeRule->boardAddress = message->data[1];
+    activeRule->solenoidNum = message->data[2];
+    activeRule->attackStatus = message->data[3];
+    activeRule->attackDuration = message->data[4];
+
+    if(message->dataLength >= 7) {
+        activeRule->sustainStatus = message->data[5];
+        activeRule->sustainDuration = message->data[6];
+    } else {
+        activeRule->sustainStatus = 0;
+        activeRule->sustainDuration = 0;
+    }
+
+    encodeRule(instance, activeRule);
+}
+
+static void sendRuleCooldowns(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    diypinball_pinballMessage_t response;
+    diypinball_switchStatus_t *status;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    status = &(instance->switches[switchNum]);
+
+    response.priority = message->priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x0F;
+    response.reserved = switchBank(switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 8;
+    response.data[0] = (uint8_t) (status->closeRule.cooldown & 0xFF);
+    response.data[1] = (uint8_t) (status->closeRule.cooldown >> 8);
+    response.data[2] = (uint8_t) (status->openRule.cooldown & 0xFF);
+    response.data[3] = (uint8_t) (status->openRule.cooldown >> 8);
+    response.data[4] = (uint8_t) (status->closeRule.suppressedCount & 0xFF);
+    response.data[5] = (uint8_t) (status->closeRule.suppressedCount >> 8);
+    response.data[6] = (uint8_t) (status->openRule.suppressedCount & 0xFF);
+    response.data[7] = (uint8_t) (status->openRule.suppressedCount >> 8);
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setRuleCooldown(diypinball_switchRule_t *rule, uint16_t cooldown, uint32_t tick) {
+    rule->cooldown = cooldown;
+    rule->suppressedCount = 0;
+    // the next firing is never held off by one from before the cooldown was set
+    rule->lastFireTick = tick - cooldown;
+}
+
+static void setRuleCooldowns(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint32_t tick;
+
+    uint8_t switchNum = messageSwitchNum(message);
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(message->dataLength < 4) {
+        return;
+    }
+
+    tick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+
+    setRuleCooldown(&(instance->switches[switchNum].closeRule), (uint16_t) (message->data[0] | (message->data[1] << 8)), tick);
+    setRuleCooldown(&(instance->switches[switchNum].openRule), (uint16_t) (message->data[2] | (message->data[3] << 8)), tick);
+}
+
+static void setBulkConfiguration(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t bank = message->reserved & 0x07;
+    uint16_t targets;
+    uint16_t remaining;
+    uint8_t switchNum;
+    uint8_t value;
+
+    if((bank >= DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT) || (message->dataLength < 3)) {
+        return;
+    }
+
+    targets = (uint16_t) (message->data[0] | (message->data[1] << 8)) & validSwitchMask(instance, bank);
+    value = message->data[2];
+
+    if(!targets) {
+        return;
+    }
+
+    switch(message->featureNum) {
+    case 0x01: // polling interval
+        remaining = targets;
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+            instance->switches[switchNum].pollingInterval = value;
+            instance->switches[switchNum].lastTick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+        }
+
+        if(value) {
+            instance->pollingMask[bank] |= targets;
+        } else {
+            instance->pollingMask[bank] &= (uint16_t) ~targets;
+        }
+
+        if(instance->pollingMask[bank]) {
+            instance->pollingBanks |= (uint8_t) (1U << bank);
+        } else {
+            instance->pollingBanks &= (uint8_t) ~(1U << bank);
+        }
+
+        updateNextPollTick(instance);
+        break;
+    case 0x02: // triggering
+        instance->closeTriggerMask[bank] &= (uint16_t) ~targets;
+        instance->openTriggerMask[bank] &= (uint16_t) ~targets;
+        if(value & 0x01) instance->closeTriggerMask[bank] |= targets;
+        if(value & 0x02) instance->openTriggerMask[bank] |= targets;
+        break;
+    case 0x03: // debouncing
+        remaining = targets;
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+            instance->switches[switchNum].debounceLimit = value;
+            if(!instance->bulkDebounceChangedHandler) {
+                (instance->debounceChangedHandler)(switchNum, value);
+            }
+        }
+
+        if(instance->bulkDebounceChangedHandler) {
+            (instance->bulkDebounceChangedHandler)(bank, targets, value);
+        }
+        break;
+    case 0x0E: // report priority
+        if(value > 0x0F) {
+            break;
+        }
+
+        remaining = targets;
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+            instance->switches[switchNum].reportPriority = value;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// returns the switches of the bank whose transitions are suppressed for chattering
+static uint16_t countChatter(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t changed, uint16_t states) {
+    diypinball_switchStatus_t *status;
+    uint32_t tick;
+    uint16_t bit;
+    uint8_t switchNum;
+
+    if(!instance->chatterLimit) {
+        return 0;
+    }
+
+    tick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+
+    while(changed) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(changed));
+        bit = switchBit(switchNum);
+        changed &= (uint16_t) (changed - 1);
+        status = &(instance->switches[switchNum]);
+
+        if(instance->chatterMask[bank] & bit) {
+            // the quiet window that re-enables the switch starts over with every edge
+            status->chatterTick = tick;
+            continue;
+        }
+
+        if((tick - status->chatterTick) >= instance->chatterWindow) {
+            status->chatterTick = tick;
+            status->chatterCount = 0;
+        }
+
+        status->chatterCount++;
+        if(status->chatterCount > instance->chatterLimit) {
+            instance->chatterMask[bank] |= bit;
+            instance->chatterBanks |= (uint8_t) (1U << bank);
+            status->chatterTick = tick;
+            sendSwitchFault(instance, switchNum, DIYPINBALL_SWITCHFAULT_CHATTER, (states & bit) ? 1 : 0);
+            diypinball_featureRouter_scheduleTick(instance->featureHandlerInstance.routerInstance, instance->featureHandlerInstance.featureType, instance->chatterWindow);
+        }
+    }
+
+    return instance->chatterMask[bank];
+}
+
+static uint32_t releaseQuietSwitches(diypinball_switchFeatureHandlerInstance_t *instance, uint32_t tickNum) {
+    diypinball_switchStatus_t *status;
+    uint32_t nextTick = DIYPINBALL_TICK_NONE;
+    uint32_t elapsed;
+    uint16_t remaining;
+    uint16_t bit;
+    uint8_t switchNum;
+    uint8_t state;
+    uint8_t bank;
+
+    for(bank = 0; bank < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; bank++) {
+        remaining = instance->chatterMask[bank];
+
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            bit = switchBit(switchNum);
+            remaining &= (uint16_t) (remaining - 1);
+            status = &(instance->switches[switchNum]);
+
+            elapsed = tickNum - status->chatterTick;
+            if(elapsed < instance->chatterWindow) {
+                if((instance->chatterWindow - elapsed) < nextTick) {
+                    nextTick = instance->chatterWindow - elapsed;
+                }
+                continue;
+            }
+
+            instance->chatterMask[bank] &= (uint16_t) ~bit;
+            status->chatterCount = 0;
+
+            state = (instance->switchState[bank] & bit) ? 1 : 0;
+            sendSwitchFault(instance, switchNum, DIYPINBALL_SWITCHFAULT_NONE, state);
+
+            // a switch that settled closed starts its stuck timer now
+            if(state) {
+                status->closeTick = tickNum;
+                if(instance->stuckLimit) {
+                    scheduleStuckCheck(instance, tickNum);
+                }
+            }
+        }
+
+        if(!instance->chatterMask[bank]) {
+            instance->chatterBanks &= (uint8_t) ~(1U << bank);
+        }
+    }
+
+    return nextTick;
+}
+
+static void checkStuckSwitches(diypinball_switchFeatureHandlerInstance_t *instance, uint32_t tickNum) {
+    uint32_t deadline;
+    uint16_t remaining;
+    uint8_t switchNum;
+    uint8_t bank;
+
+    instance->stuckCheckPending = 0;
+
+    for(bank = 0; bank < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; bank++) {
+        remaining = instance->switchState[bank] & (uint16_t) ~(instance->stuckMask[bank] | instance->chatterMask[bank]);
+
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+
+            deadline = instance->switches[switchNum].closeTick + ((uint32_t) instance->stuckLimit * 100);
+            if(POLL_REACHED(tickNum, deadline)) {
+                instance->stuckMask[bank] |= switchBit(switchNum);
+                sendSwitchFault(instance, switchNum, DIYPINBALL_SWITCHFAULT_STUCK, 1);
+            } else if(!instance->stuckCheckPending || POLL_REACHED(instance->nextStuckTick, deadline)) {
+                instance->nextStuckTick = deadline;
+                instance->stuckCheckPending = 1;
+            }
+        }
+    }
+}
+
+static void releaseSwitchFaults(diypinball_switchFeatureHandlerInstance_t *instance, uint16_t *faultMask) {
+    uint16_t remaining;
+    uint8_t switchNum;
+    uint8_t bank;
 
-    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &command);
+    for(bank = 0; bank < DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; bank++) {
+        remaining = faultMask[bank];
+        faultMask[bank] = 0;
+
+        while(remaining) {
+            switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+            remaining &= (uint16_t) (remaining - 1);
+            sendSwitchFault(instance, switchNum, DIYPINBALL_SWITCHFAULT_NONE, (instance->switchState[bank] & switchBit(switchNum)) ? 1 : 0);
+        }
+    }
 }
 
-static void sendSwitchUpdate(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t state, uint8_t priority) {
+static void sendSwitchFaultLimits(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
     diypinball_pinballMessage_t response;
 
-    response.priority = priority;
+    response.priority = message->priority;
     response.unitSpecific = 0x01;
     response.featureType = 0x01;
-    response.featureNum = switchNum;
-    response.function = 0x00;
+    response.featureNum = 0;
+    response.function = 0x0D;
     response.reserved = 0x00;
     response.messageType = MESSAGE_RESPONSE;
 
-    response.dataLength = 2;
-    response.data[0] = state;
-    if(state && !(instance->switches[switchNum].lastState)) {
-        response.data[1] = 1;
-    } else if((!state) && instance->switches[switchNum].lastState) {
-        response.data[1] = 2;
-    } else {
-        response.data[1] = 0;
-    }
+    response.dataLength = 3;
+    response.data[0] = instance->chatterLimit;
+    response.data[1] = instance->chatterWindow;
+    response.data[2] = instance->stuckLimit;
 
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
-    if(response.data[1] == 1) {
-        fireRule(instance, switchNum, 1);
-    } else if(response.data[1] == 2) {
-        fireRule(instance, switchNum, 0);
-    }
 }
 
-static void sendSwitchStatus(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
-    uint8_t newState;
-    uint8_t switchNum = message->featureNum;
-    if(switchNum >= instance->numSwitches) {
+static void setSwitchFaultLimits(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    if(message->dataLength < 3) {
         return;
     }
 
-    (instance->readStateHandler)(&newState, switchNum);
+    instance->chatterLimit = message->data[0];
+    instance->chatterWindow = message->data[1];
+    instance->stuckLimit = message->data[2];
+
+    // turning detection off re-enables every switch it had suppressed
+    if(!instance->chatterLimit) {
+        releaseSwitchFaults(instance, instance->chatterMask);
+        instance->chatterBanks = 0;
+    }
 
-    sendSwitchUpdate(instance, switchNum, newState, message->priority);
-    if(newState != instance->switches[switchNum].lastState) {
-        instance->switches[switchNum].lastState = newState;
+    if(instance->stuckLimit) {
+        // re-check every closed switch against the new limit on the next tick
+        instance->nextStuckTick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
+        instance->stuckCheckPending = 1;
+    } else {
+        releaseSwitchFaults(instance, instance->stuckMask);
+        instance->stuckCheckPending = 0;
     }
 }
 
-static void sendSwitchPolling(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+static void sendDeltaReportWindow(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
     diypinball_pinballMessage_t response;
 
-    uint8_t switchNum = message->featureNum;
-    if(switchNum >= instance->numSwitches) {
-        return;
-    }
-
     response.priority = message->priority;
     response.unitSpecific = 0x01;
     response.featureType = 0x01;
-    response.featureNum = switchNum;
-    response.function = 0x01;
+    response.featureNum = 0;
+    response.function = 0x08;
     response.reserved = 0x00;
     response.messageType = MESSAGE_RESPONSE;
 
     response.dataLength = 1;
-    response.data[0] = instance->switches[switchNum].pollingInterval;
+    response.data[0] = instance->deltaReportWindow;
 
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
-static void setSwitchPolling(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
-    uint8_t switchNum = message->featureNum;
-    if(switchNum >= instance->numSwitches) {
-        return;
-    }
-
+static void setDeltaReportWindow(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
     if(message->dataLength < 1) {
         return;
     }
 
-    instance->switches[switchNum].pollingInterval = message->data[0];
+    instance->deltaReportWindow = message->data[0];
+
+    // don't strand transitions that were waiting on a window which no longer exists
+    if(!instance->deltaReportWindow) {
+        flushDeltaReports(instance);
+    }
 }
 
-static void sendSwitchTriggering(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+static void sendSwitchAction(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
     diypinball_pinballMessage_t response;
+    diypinball_switchAction_t *action;
 
-    uint8_t switchNum = message->featureNum;
-    if(switchNum >= instance->numSwitches) {
+    uint8_t actionNum = message->featureNum;
+    if(actionNum >= DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT) {
         return;
     }
 
+    action = &(instance->actions[actionNum]);
+
     response.priority = message->priority;
     response.unitSpecific = 0x01;
     response.featureType = 0x01;
-    response.featureNum = switchNum;
-    response.function = 0x02;
-    response.reserved = 0x00;
+    response.featureNum = actionNum;
+    response.function = 0x09;
+    response.reserved = switchBank(action->switchNum);
     response.messageType = MESSAGE_RESPONSE;
 
-    response.dataLength = 1;
-    response.data[0] = instance->switches[switchNum].messageTriggerMask;
+    response.dataLength = 8;
+    response.data[0] = (action->switchNum & 0x0F) | ((action->eventMask & 0x03) << 4);
+    response.data[1] = ((action->type & 0x0F) << 4) | (action->targetNum & 0x0F);
+    response.data[2] = action->guard;
+    response.data[3] = action->boardAddress;
+    response.data[4] = action->params[0];
+    response.data[5] = action->params[1];
+    response.data[6] = action->params[2];
+    response.data[7] = action->params[3];
 
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
-static void setSwitchTriggering(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
-    uint8_t switchNum = message->featureNum;
-    if(switchNum >= instance->numSwitches) {
+static void setSwitchAction(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    diypinball_switchAction_t *action;
+    uint8_t switchNum;
+    uint8_t type;
+    uint8_t i;
+
+    uint8_t actionNum = message->featureNum;
+    if(actionNum >= DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT) {
         return;
     }
 
-    if(message->dataLength < 1) {
+    if(message->dataLength < 2) {
         return;
     }
 
-    instance->switches[switchNum].messageTriggerMask = message->data[0] & 0x03;
+    // featureNum picks the entry, so the bank of the action's switch comes from the reserved field
+    switchNum = (uint8_t) (((message->reserved & 0x07) << 4) | (message->data[0] & 0x0F));
+    type = message->data[1] >> 4;
+
+    if((type != DIYPINBALL_SWITCHACTION_NONE) && ((message->dataLength < 4) || (switchNum >= instance->numSwitches) || (type > DIYPINBALL_SWITCHACTION_HOST))) {
+        return;
+    }
+
+    // runActions only has the triggering bank's states to hand, so a guard can't reach into another bank
+    if((type != DIYPINBALL_SWITCHACTION_NONE) && (message->data[2] & DIYPINBALL_SWITCHACTION_GUARD_ENABLE)) {
+        if((message->data[2] & 0x30) || ((uint8_t) ((switchNum & 0xF0) | (message->data[2] & 0x0F)) >= instance->numSwitches)) {
+            return;
+        }
+    }
+
+    action = &(instance->actions[actionNum]);
+    clearAction(action);
+
+    if(type != DIYPINBALL_SWITCHACTION_NONE) {
+        action->switchNum = switchNum;
+        action->eventMask = (message->data[0] >> 4) & 0x03;
+        action->type = type;
+        action->targetNum = message->data[1] & 0x0F;
+        action->guard = message->data[2] & (DIYPINBALL_SWITCHACTION_GUARD_ENABLE | DIYPINBALL_SWITCHACTION_GUARD_CLOSED | 0x0F);
+        action->boardAddress = message->data[3];
+        // params not sent are left at 0
+        for(i = 0; (i < 4) && ((uint8_t) (i + 4) < message->dataLength); i++) {
+            action->params[i] = message->data[i + 4];
+        }
+    }
+
+    updateActionSwitchMask(instance);
 }
 
-static void sendSwitchDebounce(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+static void sendSwitchStatistics(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
     diypinball_pinballMessage_t response;
+    diypinball_switchStatistics_t *statistics;
 
-    uint8_t switchNum = message->featureNum;
+    uint8_t switchNum = messageSwitchNum(message);
     if(switchNum >= instance->numSwitches) {
         return;
     }
 
+    statistics = &(instance->switches[switchNum].statistics);
+
     response.priority = message->priority;
     response.unitSpecific = 0x01;
     response.featureType = 0x01;
-    response.featureNum = switchNum;
-    response.function = 0x03;
-    response.reserved = 0x00;
+    response.featureNum = switchNum & 0x0F;
+    response.function = 0x0C;
+    response.reserved = switchBank(switchNum);
     response.messageType = MESSAGE_RESPONSE;
 
-    response.dataLength = 1;
-    response.data[0] = instance->switches[switchNum].debounceLimit;
+    response.dataLength = 8;
+    response.data[0] = (uint8_t) (statistics->activationCount & 0xFF);
+    response.data[1] = (uint8_t) (statistics->activationCount >> 8);
+    response.data[2] = (uint8_t) (statistics->bounceCount & 0xFF);
+    response.data[3] = (uint8_t) (statistics->bounceCount >> 8);
+    response.data[4] = (uint8_t) (statistics->minClosedTime & 0xFF);
+    response.data[5] = (uint8_t) (statistics->minClosedTime >> 8);
+    response.data[6] = (uint8_t) (statistics->minOpenTime & 0xFF);
+    response.data[7] = (uint8_t) (statistics->minOpenTime >> 8);
 
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
-static void setSwitchDebounce(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
-    uint8_t switchNum = message->featureNum;
+static void resetSwitchStatistics(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t switchNum = messageSwitchNum(message);
     if(switchNum >= instance->numSwitches) {
         return;
     }
 
-    if(message->dataLength < 1) {
-        return;
-    }
-
-    instance->switches[switchNum].debounceLimit = message->data[0];
-    (instance->debounceChangedHandler)(switchNum, message->data[0]);
+    clearStatistics(&(instance->switches[switchNum]));
+    instance->switches[switchNum].transitionTick = diypinball_featureRouter_getTick(instance->featureHandlerInstance.routerInstance);
 }
+#endif
 
-static void sendSwitchRule(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message, uint8_t rule) {
+static void sendJournalStatus(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
     diypinball_pinballMessage_t response;
-    diypinball_switchRule_t *activeRule;
-    uint8_t ruleMask;
-
-    uint8_t switchNum = message->featureNum;
-    if(switchNum >= instance->numSwitches) {
-        return;
-    }
-
-    activeRule = rule ? &(instance->switches[switchNum].closeRule) : &(instance->switches[switchNum].openRule);
-    ruleMask = rule ? 0x02 : 0x01;
 
     response.priority = message->priority;
     response.unitSpecific = 0x01;
     response.featureType = 0x01;
-    response.featureNum = switchNum;
-    response.function = rule ? 0x05 : 0x04;
+    response.featureNum = 0;
+    response.function = 0x0A;
     response.reserved = 0x00;
     response.messageType = MESSAGE_RESPONSE;
 
-    response.dataLength = 7;
-    response.data[0] = instance->switches[switchNum].ruleMask & ruleMask ? 1 : 0;
-    response.data[1] = activeRule->boardAddress;
-    response.data[2] = activeRule->solenoidNum;
-    response.data[3] = activeRule->attackStatus;
-    response.data[4] = activeRule->attackDuration;
-    response.data[5] = activeRule->sustainStatus;
-    response.data[6] = activeRule->sustainDuration;
+    // three bytes, never the length of a replayed event
+    response.dataLength = 3;
+    response.data[0] = instance->journalSequence;
+    response.data[1] = instance->journalCount;
+    response.data[2] = DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE;
 
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
-static void setSwitchRule(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message, uint8_t rule) {
-    diypinball_switchRule_t *activeRule;
-    uint8_t ruleMask;
-    uint8_t switchNum = message->featureNum;
+// one entry per tick, and only into a free transmit queue slot, so a replay can't crowd out live reports
+static void replayJournalEntry(diypinball_switchFeatureHandlerInstance_t *instance) {
+    diypinball_featureRouterInstance_t *router = instance->featureHandlerInstance.routerInstance;
+    diypinball_pinballMessage_t response;
+    diypinball_switchJournalEntry_t *entry;
+    uint8_t age;
 
-    if(switchNum >= instance->numSwitches) {
-        return;
+    // entries overwritten by transitions since the replay started are gone
+    while(instance->replayCount && ((uint8_t) (instance->journalSequence - instance->replaySequence) >= instance->journalCount)) {
+        instance->replaySequence++;
+        instance->replayCount--;
     }
 
-    if(message->dataLength == 0) {
+    if(!instance->replayCount || !diypinball_featureRouter_getTxQueueSpace(router)) {
         return;
     }
 
-    if((message->data[0]) && (message->dataLength < 5)) {
-        // not enough data for rule
-        return;
+    age = (uint8_t) (instance->journalSequence - instance->replaySequence);
+    entry = &(instance->journal[(uint8_t) (instance->journalHead - 1 - age) & (DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE - 1)]);
+
+    response.priority = instance->replayPriority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x01;
+    response.featureNum = entry->switchNum & 0x0F;
+    response.function = 0x0A;
+    response.reserved = switchBank(entry->switchNum);
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.dataLength = 2;
+    response.data[0] = entry->sequence;
+    response.data[1] = entry->state;
+
+    if(instance->timestampHandler) {
+        response.dataLength = 6;
+        packTimestamp(&(response.data[2]), entry->eventTime);
     }
 
-    activeRule = rule ? &(instance->switches[switchNum].closeRule) : &(instance->switches[switchNum].openRule);
-    ruleMask = rule ? 0x02 : 0x01;
+    instance->replaySequence++;
+    instance->replayCount--;
 
-    // if an existing rule is there (mask is set), send a deactivation message to that solenoid
-    if(instance->switches[switchNum].ruleMask & ruleMask) {
-        fireDeactivationRule(instance, switchNum, rule);
+    diypinball_featureRouter_sendPinballMessage(router, &response);
+}
+
+static void startJournalReplay(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t missed;
+
+    if(message->dataLength < 1) {
+        return;
     }
 
-    instance->switches[switchNum].ruleMask &= ~ruleMask;
-    instance->switches[switchNum].ruleMask |= message->data[0] ? ruleMask : 0;
-    activeRule->boardAddress = message->data[1];
-    activeRule->solenoidNum = message->data[2];
-    activeRule->attackStatus = message->data[3];
-    activeRule->attackDuration = message->data[4];
+    // events after the host's last sequence number, older ones than the journal holds are gone
+    missed = (uint8_t) (instance->journalSequence - message->data[0]);
+    if(missed > instance->journalCount) {
+        missed = instance->journalCount;
+    }
 
-    if(message->dataLength >= 7) {
-        activeRule->sustainStatus = message->data[5];
-        activeRule->sustainDuration = message->data[6];
-    } else {
-        activeRule->sustainStatus = 0;
-        activeRule->sustainDuration = 0;
+    instance->replaySequence = (uint8_t) (instance->journalSequence - missed + 1);
+    instance->replayCount = missed;
+    instance->replayPriority = message->priority;
+
+    replayJournalEntry(instance);
+    if(instance->replayCount) {
+        diypinball_featureRouter_scheduleTick(instance->featureHandlerInstance.routerInstance, instance->featureHandlerInstance.featureType, 1);
     }
 }
 
-static void sendAllSwitchStatus(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
-    uint8_t newState;
+static void sendSwitchStatusPage(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message, uint8_t bank) {
+    uint16_t states;
+    uint16_t changed;
+    uint32_t timestamp;
 
     diypinball_pinballMessage_t response;
 
@@ -302,62 +1515,116 @@ static void sendAllSwitchStatus(diypinball_switchFeatureHandlerInstance_t *insta
     response.featureType = 0x01;
     response.featureNum = 0;
     response.function = 0x06;
-    response.reserved = 0x00;
+    response.reserved = bank;
     response.messageType = MESSAGE_RESPONSE;
 
-    response.data[0] = 0;
-    response.data[1] = 0;
-
     uint8_t i;
 
-    for(i=0; i < instance->numSwitches; i++) {
-        (instance->readStateHandler)(&newState, i);
-
-        if(newState != instance->switches[i].lastState) {
-            instance->switches[i].lastState = newState; // also fire rules?
-        }
+    states = readSwitchStates(instance, bank, validSwitchMask(instance, bank));
 
-        if(newState) {
-            if(i < 8) {
-                response.data[0] |= (1 << i);
-            } else {
-                response.data[1] |= (1 << (i - 8));
+    changed = states ^ instance->switchState[bank];
+    if(changed) {
+        timestamp = captureTimestamp(instance);
+        for(i=0; i < 16; i++) {
+            if(changed & switchBit(i)) {
+                instance->switches[(bank << 4) | i].eventTime = timestamp;
             }
         }
-    }   
+        journalTransitions(instance, bank, changed, states);
+        recordTransitions(instance, bank, changed, states);
+    }
+
+    instance->switchState[bank] = states; // also fire rules?
 
     response.dataLength = 2;
+    response.data[0] = (uint8_t) (states & 0xFF);
+    response.data[1] = (uint8_t) (states >> 8);
 
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
+static void sendAllSwitchStatus(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_pinballMessage_t *message) {
+    uint8_t bank = 0;
+
+    // one page of 16 switches per bank, with the bank in the reserved field
+    do {
+        sendSwitchStatusPage(instance, message, bank);
+        bank++;
+    } while(bank < bankCount(instance));
+}
+
 void diypinball_switchFeatureHandler_init(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchFeatureHandlerInit_t *init) {
     instance->numSwitches = init->numSwitches;
-    if(instance->numSwitches > 16) instance->numSwitches = 16;
+    if(instance->numSwitches > DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES) instance->numSwitches = DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES;
 
     instance->readStateHandler = init->readStateHandler;
+    instance->readAllStatesHandler = init->readAllStatesHandler;
     instance->debounceChangedHandler = init->debounceChangedHandler;
+    instance->bulkDebounceChangedHandler = NULL;
 
     uint8_t i;
-    for(i=0; i<16; i++) {
-        instance->switches[i].lastState = 0;
-        instance->switches[i].messageTriggerMask = 0;
+    instance->pollingBanks = 0;
+    instance->nextPollTick = 0;
+    instance->deltaReportWindow = 0;
+    instance->pendingDeltaBanks = 0;
+    instance->deltaStartTick = 0;
+    instance->deltaStartTime = 0;
+    instance->timestampHandler = NULL;
+    instance->localCoils = NULL;
+    instance->announceLocalRules = 0;
+    instance->chatterLimit = 0;
+    instance->chatterWindow = 0;
+    instance->stuckLimit = 0;
+    instance->chatterBanks = 0;
+    instance->nextStuckTick = 0;
+    instance->stuckCheckPending = 0;
+    instance->journalHead = 0;
+    instance->journalCount = 0;
+    instance->journalSequence = 0;
+    instance->reportJournalSequence = 0;
+    instance->replaySequence = 0;
+    instance->replayCount = 0;
+    instance->replayPriority = 0;
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE; i++) {
+        instance->journal[i].sequence = 0;
+        instance->journal[i].switchNum = 0;
+        instance->journal[i].state = 0;
+        instance->journal[i].eventTime = 0;
+    }
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        clearAction(&(instance->actions[i]));
+    }
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; i++) {
+        instance->switchState[i] = 0;
+        instance->pollingMask[i] = 0;
+        instance->closeTriggerMask[i] = 0;
+        instance->openTriggerMask[i] = 0;
+        instance->closeRuleMask[i] = 0;
+        instance->openRuleMask[i] = 0;
+        instance->pendingDeltaMask[i] = 0;
+        instance->actionSwitchMask[i] = 0;
+        instance->chatterMask[i] = 0;
+        instance->stuckMask[i] = 0;
+    }
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES; i++) {
         instance->switches[i].pollingInterval = 0;
         instance->switches[i].lastTick = 0;
         instance->switches[i].debounceLimit = 0;
-        instance->switches[i].ruleMask = 0;
-        instance->switches[i].closeRule.boardAddress = 0;
-        instance->switches[i].closeRule.solenoidNum = 0;
-        instance->switches[i].closeRule.attackStatus = 0;
-        instance->switches[i].closeRule.attackDuration = 0;
-        instance->switches[i].closeRule.sustainStatus = 0;
-        instance->switches[i].closeRule.sustainDuration = 0;
-        instance->switches[i].openRule.boardAddress = 0;
-        instance->switches[i].openRule.solenoidNum = 0;
-        instance->switches[i].openRule.attackStatus = 0;
-        instance->switches[i].openRule.attackDuration = 0;
-        instance->switches[i].openRule.sustainStatus = 0;
-        instance->switches[i].openRule.sustainDuration = 0;
+        instance->switches[i].eventTime = 0;
+        instance->switches[i].closeTick = 0;
+        instance->switches[i].chatterTick = 0;
+        instance->switches[i].chatterCount = 0;
+        instance->switches[i].journalSequence = 0;
+        instance->switches[i].reportPriority = DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY;
+        clearRule(&(instance->switches[i].closeRule));
+        clearRule(&(instance->switches[i].openRule));
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+        clearStatistics(&(instance->switches[i]));
+#endif
     }
 
     instance->featureHandlerInstance.concreteFeatureHandlerInstance = (void*) instance;
@@ -368,26 +1635,55 @@ void diypinball_switchFeatureHandler_init(diypinball_switchFeatureHandlerInstanc
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_switchFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+uint32_t diypinball_switchFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
     diypinball_switchFeatureHandlerInstance_t* typedInstance = (diypinball_switchFeatureHandlerInstance_t *) instance;
 
-    uint8_t i;
-    uint8_t newState;
+    uint32_t elapsed;
+    uint32_t nextTick = DIYPINBALL_TICK_NONE;
 
-    for(i=0; i<typedInstance->numSwitches; i++) {
-        if(typedInstance->switches[i].pollingInterval) {
-            if(tickNum - typedInstance->switches[i].lastTick >= typedInstance->switches[i].pollingInterval) {
-                typedInstance->switches[i].lastTick = tickNum;
-                // send switch update
-                (typedInstance->readStateHandler)(&newState, i);
+    if(typedInstance->pendingDeltaBanks) {
+        elapsed = tickNum - typedInstance->deltaStartTick;
+        if(elapsed >= typedInstance->deltaReportWindow) {
+            flushDeltaReports(typedInstance);
+        } else {
+            nextTick = typedInstance->deltaReportWindow - elapsed;
+        }
+    }
 
-                sendSwitchUpdate(typedInstance, i, newState, 0x01); // FIXME constant priority
-                if(newState != typedInstance->switches[i].lastState) {
-                    typedInstance->switches[i].lastState = newState;
-                }
-            }
+    // idle ticks only compare against the earliest poll deadline
+    if(typedInstance->pollingBanks) {
+        if(POLL_REACHED(tickNum, typedInstance->nextPollTick)) {
+            pollSwitches(typedInstance, tickNum);
+        }
+        if((typedInstance->nextPollTick - tickNum) < nextTick) {
+            nextTick = typedInstance->nextPollTick - tickNum;
         }
     }
+
+    if(typedInstance->chatterBanks) {
+        elapsed = releaseQuietSwitches(typedInstance, tickNum);
+        if(elapsed < nextTick) {
+            nextTick = elapsed;
+        }
+    }
+
+    if(typedInstance->stuckCheckPending) {
+        if(POLL_REACHED(tickNum, typedInstance->nextStuckTick)) {
+            checkStuckSwitches(typedInstance, tickNum);
+        }
+        if(typedInstance->stuckCheckPending && ((typedInstance->nextStuckTick - tickNum) < nextTick)) {
+            nextTick = typedInstance->nextStuckTick - tickNum;
+        }
+    }
+
+    if(typedInstance->replayCount) {
+        replayJournalEntry(typedInstance);
+        if(typedInstance->replayCount && (nextTick > 1)) {
+            nextTick = 1;
+        }
+    }
+
+    return nextTick;
 }
 
 void diypinball_switchFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -432,12 +1728,74 @@ void diypinball_switchFeatureHandler_messageReceivedHandler(void *instance, diyp
             setSwitchRule(typedInstance, message, 1);
         }
         break;
-    case 0x06: // Switch status - all
+    case 0x06: // Switch status - all, one page per bank of 16, polls of several switches also report here with a mask of those covered
         if(message->messageType == MESSAGE_REQUEST) {
             sendAllSwitchStatus(typedInstance, message);
         }
         break;
+    case 0x07: // Switch delta report - requestable only, flushes pending transitions
+        if(message->messageType == MESSAGE_REQUEST) {
+            requestDeltaReport(typedInstance, message->priority);
+        }
+        break;
+    case 0x08: // Switch delta report window - set or requestable
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendDeltaReportWindow(typedInstance, message);
+        } else {
+            setDeltaReportWindow(typedInstance, message);
+        }
+        break;
+    case 0x09: // Switch action table entry, featureNum is the entry - set or requestable
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendSwitchAction(typedInstance, message);
+        } else {
+            setSwitchAction(typedInstance, message);
+        }
+        break;
+    case 0x0A: // Switch journal - request for the newest sequence number, count and journal size, message replays events after data[0]
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendJournalStatus(typedInstance, message);
+        } else {
+            startJournalReplay(typedInstance, message);
+        }
+        break;
+    case 0x0B: // Bulk configuration - featureNum is the function being configured, data is a bitmap of switches in the bank and the value
+        if(message->messageType != MESSAGE_REQUEST) {
+            setBulkConfiguration(typedInstance, message);
+        }
+        break;
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+    case 0x0C: // Switch statistics - requestable, a message clears them
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendSwitchStatistics(typedInstance, message);
+        } else {
+            resetSwitchStatistics(typedInstance, message);
+        }
+        break;
+#endif
+    case 0x0D: // Switch fault limits - set or requestable, faults are also reported here per switch
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendSwitchFaultLimits(typedInstance, message);
+        } else {
+            setSwitchFaultLimits(typedInstance, message);
+        }
+        break;
+    case 0x0E: // Switch report priority - set or requestable
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendSwitchReportPriority(typedInstance, message);
+        } else {
+            setSwitchReportPriority(typedInstance, message);
+        }
+        break;
+    case 0x0F: // Rule cooldowns - set or requestable, requests also give the suppressed firing counts
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendRuleCooldowns(typedInstance, message);
+        } else {
+            setRuleCooldowns(typedInstance, message);
+        }
+        break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 }
@@ -451,46 +1809,192 @@ void diypinball_switchFeatureHandler_deinit(diypinball_switchFeatureHandlerInsta
 
     instance->numSwitches = 0;
     instance->readStateHandler = NULL;
+    instance->readAllStatesHandler = NULL;
     instance->debounceChangedHandler = NULL;
+    instance->bulkDebounceChangedHandler = NULL;
 
     uint8_t i;
-    for(i=0; i<16; i++) {
-        instance->switches[i].lastState = 0;
-        instance->switches[i].messageTriggerMask = 0;
+    instance->pollingBanks = 0;
+    instance->nextPollTick = 0;
+    instance->deltaReportWindow = 0;
+    instance->pendingDeltaBanks = 0;
+    instance->deltaStartTick = 0;
+    instance->deltaStartTime = 0;
+    instance->timestampHandler = NULL;
+    instance->localCoils = NULL;
+    instance->announceLocalRules = 0;
+    instance->chatterLimit = 0;
+    instance->chatterWindow = 0;
+    instance->stuckLimit = 0;
+    instance->chatterBanks = 0;
+    instance->nextStuckTick = 0;
+    instance->stuckCheckPending = 0;
+    instance->journalHead = 0;
+    instance->journalCount = 0;
+    instance->journalSequence = 0;
+    instance->reportJournalSequence = 0;
+    instance->replaySequence = 0;
+    instance->replayCount = 0;
+    instance->replayPriority = 0;
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE; i++) {
+        instance->journal[i].sequence = 0;
+        instance->journal[i].switchNum = 0;
+        instance->journal[i].state = 0;
+        instance->journal[i].eventTime = 0;
+    }
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        clearAction(&(instance->actions[i]));
+    }
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT; i++) {
+        instance->switchState[i] = 0;
+        instance->pollingMask[i] = 0;
+        instance->closeTriggerMask[i] = 0;
+        instance->openTriggerMask[i] = 0;
+        instance->closeRuleMask[i] = 0;
+        instance->openRuleMask[i] = 0;
+        instance->pendingDeltaMask[i] = 0;
+        instance->actionSwitchMask[i] = 0;
+        instance->chatterMask[i] = 0;
+        instance->stuckMask[i] = 0;
+    }
+
+    for(i=0; i<DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES; i++) {
         instance->switches[i].pollingInterval = 0;
         instance->switches[i].lastTick = 0;
         instance->switches[i].debounceLimit = 0;
-        instance->switches[i].ruleMask = 0;
-        instance->switches[i].closeRule.boardAddress = 0;
-        instance->switches[i].closeRule.solenoidNum = 0;
-        instance->switches[i].closeRule.attackStatus = 0;
-        instance->switches[i].closeRule.attackDuration = 0;
-        instance->switches[i].closeRule.sustainStatus = 0;
-        instance->switches[i].closeRule.sustainDuration = 0;
-        instance->switches[i].openRule.boardAddress = 0;
-        instance->switches[i].openRule.solenoidNum = 0;
-        instance->switches[i].openRule.attackStatus = 0;
-        instance->switches[i].openRule.attackDuration = 0;
-        instance->switches[i].openRule.sustainStatus = 0;
-        instance->switches[i].openRule.sustainDuration = 0;
+        instance->switches[i].eventTime = 0;
+        instance->switches[i].closeTick = 0;
+        instance->switches[i].chatterTick = 0;
+        instance->switches[i].chatterCount = 0;
+        instance->switches[i].journalSequence = 0;
+        instance->switches[i].reportPriority = 0;
+        clearRule(&(instance->switches[i].closeRule));
+        clearRule(&(instance->switches[i].openRule));
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+        clearStatistics(&(instance->switches[i]));
+#endif
     }
 }
 
 void diypinball_switchFeatureHandler_registerSwitchState(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum, uint8_t state) {
-    if(switchNum < instance->numSwitches) {
-        if(state && !(instance->switches[switchNum].lastState)) {
-            if (instance->switches[switchNum].messageTriggerMask & 0x01) {
-                sendSwitchUpdate(instance, switchNum, state, 0x01);
-            } else {
-                fireRule(instance, switchNum, 1);
-            }
-        } else if(!state && (instance->switches[switchNum].lastState)) {
-            if (instance->switches[switchNum].messageTriggerMask & 0x02) {
-                sendSwitchUpdate(instance, switchNum, state, 0x01);
-            } else {
-                fireRule(instance, switchNum, 0);
-            }
+    uint8_t bank = switchBank(switchNum);
+    uint16_t states;
+
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(state) {
+        states = instance->switchState[bank] | switchBit(switchNum);
+    } else {
+        states = instance->switchState[bank] & (uint16_t) ~switchBit(switchNum);
+    }
+
+    diypinball_switchFeatureHandler_registerSwitchBankStates(instance, bank, states);
+}
+
+void diypinball_switchFeatureHandler_registerSwitchStates(diypinball_switchFeatureHandlerInstance_t *instance, uint16_t states) {
+    diypinball_switchFeatureHandler_registerSwitchBankStates(instance, 0, states);
+}
+
+void diypinball_switchFeatureHandler_registerSwitchBankStates(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t bank, uint16_t states) {
+    uint16_t changed;
+    uint16_t rising;
+    uint16_t reported;
+    uint16_t transitions;
+    uint16_t remaining;
+    uint16_t bit;
+    uint32_t timestamp;
+    uint8_t switchNum;
+
+    if(bank >= DIYPINBALL_SWITCHFEATUREHANDLER_BANK_COUNT) {
+        return;
+    }
+
+    states &= validSwitchMask(instance, bank);
+    changed = states ^ instance->switchState[bank];
+    if(!changed) {
+        return;
+    }
+
+    // chattering switches keep their state up to date, but report and fire nothing
+    changed &= (uint16_t) ~countChatter(instance, bank, changed, states);
+
+    // one capture covers every switch in the batch
+    timestamp = captureTimestamp(instance);
+    transitions = changed;
+    rising = changed & states;
+    reported = (rising & instance->closeTriggerMask[bank]) | (changed & (uint16_t) ~rising & instance->openTriggerMask[bank]);
+
+    // in delta report mode the triggered transitions are reported later as one frame. A triggered
+    // switch fires its rule right after its report (see sendSwitchUpdate), so a queued one fires it
+    // here exactly once, and the coil timing doesn't depend on the window
+    if(instance->deltaReportWindow) {
+        if(reported) {
+            queueDeltaReport(instance, bank, reported, timestamp);
+        }
+        reported = 0;
+    }
+
+    // journal the batch first so each report carries its transition's sequence number
+    remaining = changed;
+    while(remaining) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(remaining));
+        remaining &= (uint16_t) (remaining - 1);
+        instance->switches[switchNum].eventTime = timestamp;
+    }
+    journalTransitions(instance, bank, changed, states);
+
+    // walk only the switches that changed, lowest first; switchState still holds the
+    // previous states here so sendSwitchUpdate can report the transition
+    while(changed) {
+        switchNum = (uint8_t) ((bank << 4) | lowestSetBit(changed));
+        bit = switchBit(switchNum);
+        changed &= (uint16_t) (changed - 1);
+
+        if(reported & bit) {
+            sendSwitchUpdate(instance, switchNum, (rising & bit) ? 1 : 0, instance->switches[switchNum].reportPriority);
+        } else {
+            fireRule(instance, switchNum, (rising & bit) ? 1 : 0);
+        }
+
+        if(instance->actionSwitchMask[bank] & bit) {
+            runActions(instance, switchNum, (rising & bit) ? 0x01 : 0x02, states);
         }
-        instance->switches[switchNum].lastState = state;
     }
-}
\ No newline at end of file
+
+    recordTransitions(instance, bank, transitions, states);
+    instance->switchState[bank] = states;
+}
+
+void diypinball_switchFeatureHandler_setLocalCoils(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_coilEnvelopeGeneratorInstance_t *localCoils, uint8_t announce) {
+    instance->localCoils = localCoils;
+    instance->announceLocalRules = announce ? 1 : 0;
+}
+
+void diypinball_switchFeatureHandler_setTimestampHandler(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchFeatureHandlerTimestampHandler timestampHandler) {
+    instance->timestampHandler = timestampHandler;
+}
+
+void diypinball_switchFeatureHandler_setJournalSequenceReports(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t enable) {
+    instance->reportJournalSequence = enable ? 1 : 0;
+}
+
+void diypinball_switchFeatureHandler_setBulkDebounceChangedHandler(diypinball_switchFeatureHandlerInstance_t *instance, diypinball_switchFeatureHandlerBulkDebounceChangedHandler bulkDebounceChangedHandler) {
+    instance->bulkDebounceChangedHandler = bulkDebounceChangedHandler;
+}
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+void diypinball_switchFeatureHandler_registerSwitchBounce(diypinball_switchFeatureHandlerInstance_t *instance, uint8_t switchNum) {
+    if(switchNum >= instance->numSwitches) {
+        return;
+    }
+
+    if(instance->switches[switchNum].statistics.bounceCount < 0xFFFF) {
+        instance->switches[switchNum].statistics.bounceCount++;
+    }
+}
+#endif
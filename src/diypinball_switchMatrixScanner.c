@@ -3,6 +3,7 @@
 
 static void readMatrixRow(diypinball_switchMatrixScannerInstance_t *instance) {
     uint8_t rowBuffer, switchBuffer, switchNum;
+    uint8_t accepted;
 
     instance->readRowHandler(&rowBuffer);
 
@@ -10,14 +11,22 @@ static void readMatrixRow(diypinball_switchMatrixScannerInstance_t *instance) {
     for(i=0; i<4; i++) {
         switchBuffer = (rowBuffer & (1 << i)) ? 1 : 0;
         switchNum = (instance->currentColumn * 4) + i;
+        accepted = 0;
 
         if((instance->lastTick - instance->switches[switchNum].lastTick) >= instance->switches[switchNum].debounceLimit) {
             if(switchBuffer != instance->switches[switchNum].switchState) {
                 instance->switches[switchNum].lastTick = instance->lastTick;
                 instance->switches[switchNum].switchState = switchBuffer;
                 instance->switchStateHandler(switchNum, switchBuffer);
+                accepted = 1;
             }
         }
+
+        // any other edge in the raw readings is a bounce the debounce window swallowed
+        if(!accepted && (switchBuffer != instance->switches[switchNum].rawState) && instance->switchBounceHandler) {
+            instance->switchBounceHandler(switchNum);
+        }
+        instance->switches[switchNum].rawState = switchBuffer;
     }
 }
 
@@ -28,6 +37,7 @@ void diypinball_switchMatrixScanner_init(diypinball_switchMatrixScannerInstance_
     instance->currentColumn = 0;
 
     instance->switchStateHandler = init->switchStateHandler;
+    instance->switchBounceHandler = init->switchBounceHandler;
     instance->setColumnHandler = init->setColumnHandler;
     instance->readRowHandler = init->readRowHandler;
 
@@ -36,6 +46,7 @@ void diypinball_switchMatrixScanner_init(diypinball_switchMatrixScannerInstance_
         instance->switches[i].switchState = 0;
         instance->switches[i].lastTick = 0;
         instance->switches[i].debounceLimit = 0;
+        instance->switches[i].rawState = 0;
     }
 }
 
@@ -49,6 +60,7 @@ void diypinball_switchMatrixScanner_deinit(diypinball_switchMatrixScannerInstanc
     instance->currentColumn = 0;
 
     instance->switchStateHandler = NULL;
+    instance->switchBounceHandler = NULL;
     instance->setColumnHandler = NULL;
     instance->readRowHandler = NULL;
 
@@ -57,6 +69,7 @@ void diypinball_switchMatrixScanner_deinit(diypinball_switchMatrixScannerInstanc
         instance->switches[i].switchState = 0;
         instance->switches[i].lastTick = 0;
         instance->switches[i].debounceLimit = 0;
+        instance->switches[i].rawState = 0;
     }
 }
 
@@ -161,6 +161,135 @@ static void sendBoardSignature(diypinball_systemManagementFeatureHandlerInstance
     diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
 }
 
+static uint16_t saturate16(uint64_t value) {
+    return (value > 0xFFFF) ? 0xFFFF : (uint16_t) value;
+}
+
+static void packUint16(uint8_t *data, uint16_t value) {
+    data[0] = (uint8_t) (value & 0xFF);
+    data[1] = (uint8_t) (value >> 8);
+}
+
+static void packUint32(uint8_t *data, uint32_t value) {
+    data[0] = (uint8_t) (value & 0xFF);
+    data[1] = (uint8_t) ((value >> 8) & 0xFF);
+    data[2] = (uint8_t) ((value >> 16) & 0xFF);
+    data[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t unpackUint32(const uint8_t *data) {
+    return ((uint32_t) data[0]) | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+static void sendFeatureTrafficStatistics(diypinball_systemManagementFeatureHandlerInstance_t* instance, uint8_t priority, uint8_t featureType) {
+    diypinball_pinballMessage_t response;
+    diypinball_featureStatistics_t statistics;
+
+    diypinball_featureRouter_getStatistics(instance->featureHandlerInstance.routerInstance, featureType, &statistics);
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x00;
+    response.featureNum = featureType;
+    response.function = 0x07;
+    response.reserved = 0x00;
+    response.messageType = MESSAGE_RESPONSE;
+
+    packUint16(&(response.data[0]), saturate16(statistics.rxCount));
+    packUint16(&(response.data[2]), saturate16(statistics.txCount));
+    packUint16(&(response.data[4]), saturate16(statistics.dropCount));
+    packUint16(&(response.data[6]), saturate16(statistics.unknownFunctionCount));
+
+    response.dataLength = 8;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void sendFeatureTimingStatistics(diypinball_systemManagementFeatureHandlerInstance_t* instance, uint8_t priority, uint8_t featureType) {
+    diypinball_pinballMessage_t response;
+    diypinball_featureStatistics_t statistics;
+
+    diypinball_featureRouter_getStatistics(instance->featureHandlerInstance.routerInstance, featureType, &statistics);
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x00;
+    response.featureNum = featureType;
+    response.function = 0x08;
+    response.reserved = 0x00;
+    response.messageType = MESSAGE_RESPONSE;
+
+    if(statistics.handlerCallCount) {
+        packUint16(&(response.data[0]), saturate16(statistics.handlerCyclesMin));
+        packUint16(&(response.data[2]), saturate16(statistics.handlerCyclesTotal / statistics.handlerCallCount));
+        packUint16(&(response.data[4]), saturate16(statistics.handlerCyclesMax));
+        packUint16(&(response.data[6]), saturate16(statistics.handlerCallCount));
+    } else {
+        memset(response.data, 0, 8);
+    }
+
+    response.dataLength = 8;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+#endif
+
+static void sendRouterQueueStatistics(diypinball_systemManagementFeatureHandlerInstance_t* instance, uint8_t priority) {
+    diypinball_pinballMessage_t response;
+    uint8_t rxHighWaterMark, txPeakCount;
+    uint32_t rxOverflowCount, txDropCount;
+
+    diypinball_featureRouter_getRxQueueStatistics(instance->featureHandlerInstance.routerInstance, &rxHighWaterMark, &rxOverflowCount);
+    diypinball_featureRouter_getTxQueueStatistics(instance->featureHandlerInstance.routerInstance, &txPeakCount, &txDropCount);
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x00;
+    response.featureNum = 0x00;
+    response.function = 0x09;
+    response.reserved = 0x00;
+    response.messageType = MESSAGE_RESPONSE;
+
+    response.data[0] = rxHighWaterMark;
+    response.data[1] = txPeakCount;
+
+    packUint16(&(response.data[2]), saturate16(rxOverflowCount));
+    packUint16(&(response.data[4]), saturate16(txDropCount));
+
+    response.dataLength = 6;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void sendGroupMembership(diypinball_systemManagementFeatureHandlerInstance_t* instance, uint8_t priority) {
+    diypinball_pinballMessage_t response;
+    uint32_t groupMask = diypinball_featureRouter_getGroupMask(instance->featureHandlerInstance.routerInstance);
+
+    response.priority = priority;
+    response.unitSpecific = 0x01;
+    response.featureType = 0x00;
+    response.featureNum = 0x00;
+    response.function = 0x0A;
+    response.reserved = 0x00;
+    response.messageType = MESSAGE_RESPONSE;
+
+    packUint32(response.data, groupMask);
+
+    response.dataLength = 4;
+
+    diypinball_featureRouter_sendPinballMessage(instance->featureHandlerInstance.routerInstance, &response);
+}
+
+static void setGroupMembership(diypinball_systemManagementFeatureHandlerInstance_t* instance, diypinball_pinballMessage_t *message) {
+    // only a unit-specific message can change membership, a group can't be used to rewrite itself
+    if(!(message->unitSpecific) || (message->dataLength < 4)) {
+        return;
+    }
+
+    diypinball_featureRouter_setGroupMask(instance->featureHandlerInstance.routerInstance, unpackUint32(message->data));
+}
+
 void diypinball_systemManagementFeatureHandler_init(diypinball_systemManagementFeatureHandlerInstance_t *instance, diypinball_systemManagementFeatureHandlerInit_t *init) {
     instance->firmwareVersionMajor = init->firmwareVersionMajor;
     instance->firmwareVersionMinor = init->firmwareVersionMinor;
@@ -179,15 +308,22 @@ void diypinball_systemManagementFeatureHandler_init(diypinball_systemManagementF
     diypinball_featureRouter_addFeature(init->routerInstance, &(instance->featureHandlerInstance));
 }
 
-void diypinball_systemManagementFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
+uint32_t diypinball_systemManagementFeatureHandler_millisecondTickHandler(void *instance, uint32_t tickNum) {
     diypinball_systemManagementFeatureHandlerInstance_t* typedInstance = (diypinball_systemManagementFeatureHandlerInstance_t *) instance;
-    
-    if(typedInstance->powerStatusPollingInterval) {
-        if((tickNum - typedInstance->lastTick) >= typedInstance->powerStatusPollingInterval) {
-            typedInstance->lastTick = tickNum;
-            sendPowerStatus(typedInstance, 0x0E);
-        }
+    uint32_t elapsed;
+
+    if(!typedInstance->powerStatusPollingInterval) {
+        return DIYPINBALL_TICK_NONE;
+    }
+
+    elapsed = tickNum - typedInstance->lastTick;
+    if(elapsed >= typedInstance->powerStatusPollingInterval) {
+        typedInstance->lastTick = tickNum;
+        elapsed = 0;
+        sendPowerStatus(typedInstance, 0x0E);
     }
+
+    return typedInstance->powerStatusPollingInterval - elapsed;
 }
 
 void diypinball_systemManagementFeatureHandler_messageReceivedHandler(void *instance, diypinball_pinballMessage_t *message) {
@@ -219,7 +355,30 @@ void diypinball_systemManagementFeatureHandler_messageReceivedHandler(void *inst
     case 0x06: // Board signature
         if(message->messageType == MESSAGE_REQUEST) sendBoardSignature(typedInstance, message->priority);
         break;
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    case 0x07: // Feature traffic statistics, featureNum selects the feature type - request, or set to clear all statistics
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendFeatureTrafficStatistics(typedInstance, message->priority, message->featureNum);
+        } else {
+            diypinball_featureRouter_resetStatistics(typedInstance->featureHandlerInstance.routerInstance);
+        }
+        break;
+    case 0x08: // Feature message handler timing, featureNum selects the feature type - requestable only
+        if(message->messageType == MESSAGE_REQUEST) sendFeatureTimingStatistics(typedInstance, message->priority, message->featureNum);
+        break;
+#endif
+    case 0x09: // Router queue statistics - requestable only
+        if(message->messageType == MESSAGE_REQUEST) sendRouterQueueStatistics(typedInstance, message->priority);
+        break;
+    case 0x0A: // Broadcast group membership - set or request
+        if(message->messageType == MESSAGE_REQUEST) {
+            sendGroupMembership(typedInstance, message->priority);
+        } else {
+            setGroupMembership(typedInstance, message);
+        }
+        break;
     default:
+        diypinball_featureRouter_reportUnknownFunction(typedInstance->featureHandlerInstance.routerInstance, typedInstance->featureHandlerInstance.featureType);
         break;
     }
 }
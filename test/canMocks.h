@@ -43,7 +43,7 @@ MATCHER_P(CanMessageEqual, message, "") {
 
     uint8_t i;
     if(fieldFlag) {
-        for(i=0; i < arg->dlc; i++) {
+        for(i=0; i < diypinball_dlcToLength(arg->dlc); i++) {
             if(arg->data[i] != message.data[i]) {
             	printf("Expected data byte %d: 0x%02x\r\n", i, message.data[i]);
             	printf("  Actual data byte %d: 0x%02x\r\n", i, arg->data[i]);
@@ -763,6 +763,36 @@ TEST_F(diypinball_bootloaderFeatureHandler_test, buffer_write_passes_data)
     }
 }
 
+#if DIYPINBALL_CAN_FD
+TEST_F(diypinball_bootloaderFeatureHandler_test, buffer_write_fd_frame_writes_consecutive_chunks)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    uint8_t expectedArray0[8], expectedArray1[8], expectedArray2[8];
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (7 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = diypinball_lengthToDlc(20);
+    for(uint8_t i = 0; i < 24; i++) {
+        initiatingCANMessage.data[i] = i;
+    }
+
+    for(uint8_t i = 0; i < 8; i++) {
+        expectedArray0[i] = i;
+        expectedArray1[i] = i + 8;
+        expectedArray2[i] = (i < 4) ? (i + 16) : 0xff;
+    }
+
+    InSequence dummy;
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(myBootloaderHandlers, testBufferWriteHandler(2, BootBufferEqual(expectedArray0))).Times(1);
+    EXPECT_CALL(myBootloaderHandlers, testBufferWriteHandler(3, BootBufferEqual(expectedArray1))).Times(1);
+    EXPECT_CALL(myBootloaderHandlers, testBufferWriteHandler(4, BootBufferEqual(expectedArray2))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+#endif
+
 TEST_F(diypinball_bootloaderFeatureHandler_test, buffer_write_pads_data)
 {
     diypinball_canMessage_t initiatingCANMessage;
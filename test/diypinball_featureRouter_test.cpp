@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "diypinball.h"
 #include "diypinball_featureRouter.h"
@@ -10,12 +11,14 @@
 
 using ::testing::Return;
 using ::testing::_; // Matcher for parameters
+using ::testing::InSequence;
 
 class MockHandlers {
 public:
     virtual ~MockHandlers() {}
     MOCK_METHOD2(testMessageReceivedHandler, void(void*, diypinball_pinballMessage_t*));
-    MOCK_METHOD2(testMillisecondReceivedHandler, void(void*, uint32_t));
+    MOCK_METHOD2(testMillisecondReceivedHandler, uint32_t(void*, uint32_t));
+    MOCK_METHOD2(testMessageViewReceivedHandler, void(void*, const diypinball_pinballMessageView_t*));
 };
 
 static MockCANSend* CANSendImpl;
@@ -31,16 +34,20 @@ extern "C" {
         Handler1->testMessageReceivedHandler(featureHandlerInstance, message);
     }
 
-    static void millisecondTickHandler1(void *featureHandlerInstance, uint32_t tickNum) {
-        Handler1->testMillisecondReceivedHandler(featureHandlerInstance, tickNum);
+    static void messageViewReceivedHandler1(void *featureHandlerInstance, const diypinball_pinballMessageView_t *view) {
+        Handler1->testMessageViewReceivedHandler(featureHandlerInstance, view);
+    }
+
+    static uint32_t millisecondTickHandler1(void *featureHandlerInstance, uint32_t tickNum) {
+        return Handler1->testMillisecondReceivedHandler(featureHandlerInstance, tickNum);
     }
 
     static void messageReceivedHandler2(void *featureHandlerInstance, diypinball_pinballMessage_t *message) {
         Handler2->testMessageReceivedHandler(featureHandlerInstance, message);;
     }
 
-    static void millisecondTickHandler2(void *featureHandlerInstance, uint32_t tickNum) {
-        Handler2->testMillisecondReceivedHandler(featureHandlerInstance, tickNum);
+    static uint32_t millisecondTickHandler2(void *featureHandlerInstance, uint32_t tickNum) {
+        return Handler2->testMillisecondReceivedHandler(featureHandlerInstance, tickNum);
     }
 }
 
@@ -427,6 +434,40 @@ TEST_F(diypinball_featureRouter_test, send_message_command) {
     diypinball_featureRouter_sendPinballMessage(&router, &pinballMessage);
 }
 
+TEST_F(diypinball_featureRouter_test, encode_message_then_send_matches_send_message) {
+    diypinball_pinballMessage_t pinballMessage;
+    pinballMessage.priority = 1;
+    pinballMessage.unitSpecific = 1;
+    pinballMessage.boardAddress = 43;
+    pinballMessage.featureType = 3;
+    pinballMessage.featureNum = 2;
+    pinballMessage.function = 0;
+    pinballMessage.reserved = 0;
+    pinballMessage.messageType = MESSAGE_COMMAND;
+    pinballMessage.dataLength = 4;
+    pinballMessage.data[0] = 255;
+    pinballMessage.data[1] = 25;
+    pinballMessage.data[2] = 127;
+    pinballMessage.data[3] = 0;
+
+    diypinball_canMessage_t encodedCANMessage;
+    diypinball_featureRouter_encodePinballMessage(&router, &pinballMessage, &encodedCANMessage);
+
+    diypinball_canMessage_t expectedCANMessage;
+    expectedCANMessage.id = (1 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (2 << 8) | (0 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 255;
+    expectedCANMessage.data[1] = 25;
+    expectedCANMessage.data[2] = 127;
+    expectedCANMessage.data[3] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(2);
+
+    diypinball_featureRouter_sendCANMessage(&router, &encodedCANMessage);
+    diypinball_featureRouter_sendCANMessage(&router, &encodedCANMessage);
+}
+
 TEST_F(diypinball_featureRouter_test, send_message_request) {
     diypinball_pinballMessage_t pinballMessage;
     pinballMessage.priority = 3;
@@ -464,3 +505,1345 @@ TEST_F(diypinball_featureRouter_test, send_message_request) {
 
     diypinball_featureRouter_sendPinballMessage(&router, &pinballMessage);
 }
+
+TEST_F(diypinball_featureRouter_test, enqueued_can_message_not_routed_until_processed) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 1;
+    message.data[0] = 255;
+
+    diypinball_pinballMessage_t pinballMessage;
+    pinballMessage.priority = 3;
+    pinballMessage.unitSpecific = 1;
+    pinballMessage.boardAddress = 42;
+    pinballMessage.featureType = 1;
+    pinballMessage.featureNum = 5;
+    pinballMessage.function = 6;
+    pinballMessage.reserved = 0;
+    pinballMessage.messageType = MESSAGE_COMMAND;
+    pinballMessage.dataLength = 1;
+    pinballMessage.data[0] = 255;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(0);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_enqueueCAN(&router, &message));
+
+    ::testing::Mock::VerifyAndClearExpectations(&myHandler1);
+
+    // the queue holds its own copy of the message
+    message.data[0] = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler((void*)&dummyContext1, PinballMessageEqual(pinballMessage))).Times(1);
+
+    ASSERT_EQ(1, diypinball_featureRouter_processPending(&router));
+    ASSERT_EQ(0, diypinball_featureRouter_processPending(&router));
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, enqueued_can_messages_processed_in_order) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    diypinball_canMessage_t message;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    diypinball_pinballMessage_t pinballMessage;
+    pinballMessage.priority = 3;
+    pinballMessage.unitSpecific = 1;
+    pinballMessage.boardAddress = 42;
+    pinballMessage.featureType = 1;
+    pinballMessage.function = 6;
+    pinballMessage.reserved = 0;
+    pinballMessage.messageType = MESSAGE_COMMAND;
+    pinballMessage.dataLength = 0;
+
+    {
+        InSequence dummy;
+
+        for(uint8_t i = 0; i < 3; i++) {
+            pinballMessage.featureNum = i;
+            EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, PinballMessageEqual(pinballMessage))).Times(1);
+        }
+    }
+
+    for(uint8_t i = 0; i < 3; i++) {
+        message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (i << 8) | (6 << 4) | 0;
+        diypinball_featureRouter_enqueueCAN(&router, &message);
+    }
+
+    ASSERT_EQ(3, diypinball_featureRouter_processPending(&router));
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, enqueue_tracks_high_water_mark_and_overflow) {
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    uint8_t highWaterMark;
+    uint32_t overflowCount;
+
+    diypinball_featureRouter_enqueueCAN(&router, &message);
+    diypinball_featureRouter_enqueueCAN(&router, &message);
+    diypinball_featureRouter_processPending(&router);
+    diypinball_featureRouter_enqueueCAN(&router, &message);
+
+    diypinball_featureRouter_getRxQueueStatistics(&router, &highWaterMark, &overflowCount);
+    ASSERT_EQ(2, highWaterMark);
+    ASSERT_EQ(0, overflowCount);
+
+    diypinball_featureRouter_processPending(&router);
+
+    for(uint8_t i = 0; i < DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE; i++) {
+        ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_enqueueCAN(&router, &message));
+    }
+    ASSERT_EQ(RESULT_FAIL_QUEUE_FULL, diypinball_featureRouter_enqueueCAN(&router, &message));
+    ASSERT_EQ(RESULT_FAIL_QUEUE_FULL, diypinball_featureRouter_enqueueCAN(&router, &message));
+
+    diypinball_featureRouter_getRxQueueStatistics(&router, &highWaterMark, &overflowCount);
+    ASSERT_EQ(DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE, highWaterMark);
+    ASSERT_EQ(2, overflowCount);
+
+    ASSERT_EQ(DIYPINBALL_FEATUREROUTER_RX_QUEUE_SIZE, diypinball_featureRouter_processPending(&router));
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_enqueueCAN(&router, &message));
+}
+
+static void sendTestResponse(diypinball_featureRouterInstance_t *router, uint8_t priority, uint8_t featureNum) {
+    diypinball_pinballMessage_t pinballMessage;
+    pinballMessage.priority = priority;
+    pinballMessage.unitSpecific = 1;
+    pinballMessage.boardAddress = 0;
+    pinballMessage.featureType = 2;
+    pinballMessage.featureNum = featureNum;
+    pinballMessage.function = 6;
+    pinballMessage.reserved = 0;
+    pinballMessage.messageType = MESSAGE_RESPONSE;
+    pinballMessage.dataLength = 0;
+
+    diypinball_featureRouter_sendPinballMessage(router, &pinballMessage);
+}
+
+static diypinball_canMessage_t expectedTestResponse(uint8_t priority, uint8_t featureNum) {
+    diypinball_canMessage_t expectedCANMessage;
+    expectedCANMessage.id = (priority << 25) | (1 << 24) | (42 << 16) | (2 << 12) | (featureNum << 8) | (6 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 0;
+    return expectedCANMessage;
+}
+
+TEST_F(diypinball_featureRouter_test, tx_queue_invalid_depth_rejected) {
+    ASSERT_EQ(RESULT_FAIL_INVALID_PARAMETER, diypinball_featureRouter_setTxQueueDepth(&router, DIYPINBALL_FEATUREROUTER_TX_QUEUE_SIZE + 1));
+    ASSERT_EQ(0, router.txQueue.depth);
+}
+
+TEST_F(diypinball_featureRouter_test, tx_queue_holds_messages_until_transmitted) {
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_setTxQueueDepth(&router, 4));
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    sendTestResponse(&router, 3, 1);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(3, 1)))).Times(1);
+
+    ASSERT_EQ(1, diypinball_featureRouter_transmitNext(&router));
+    ASSERT_EQ(0, diypinball_featureRouter_transmitNext(&router));
+}
+
+TEST_F(diypinball_featureRouter_test, tx_queue_sends_lowest_id_first) {
+    diypinball_featureRouter_setTxQueueDepth(&router, 4);
+
+    sendTestResponse(&router, 14, 0);
+    sendTestResponse(&router, 3, 2);
+    sendTestResponse(&router, 1, 5);
+    sendTestResponse(&router, 3, 1);
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(1, 5)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(3, 1)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(3, 2)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(14, 0)))).Times(1);
+    }
+
+    while(diypinball_featureRouter_transmitNext(&router));
+}
+
+TEST_F(diypinball_featureRouter_test, tx_queue_full_drops_least_urgent_message) {
+    uint8_t peakCount;
+    uint32_t dropCount;
+
+    diypinball_featureRouter_setTxQueueDepth(&router, 2);
+
+    sendTestResponse(&router, 14, 0);
+    sendTestResponse(&router, 3, 0);
+    sendTestResponse(&router, 1, 0); // evicts the priority 14 message
+    sendTestResponse(&router, 15, 0); // dropped
+
+    diypinball_featureRouter_getTxQueueStatistics(&router, &peakCount, &dropCount);
+    ASSERT_EQ(2, peakCount);
+    ASSERT_EQ(2, dropCount);
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(1, 0)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(3, 0)))).Times(1);
+    }
+
+    while(diypinball_featureRouter_transmitNext(&router));
+}
+
+TEST_F(diypinball_featureRouter_test, tx_queue_disabled_sends_directly) {
+    uint8_t peakCount;
+    uint32_t dropCount;
+
+    diypinball_featureRouter_setTxQueueDepth(&router, 2);
+    sendTestResponse(&router, 3, 0);
+    diypinball_featureRouter_setTxQueueDepth(&router, 0);
+
+    diypinball_featureRouter_getTxQueueStatistics(&router, &peakCount, &dropCount);
+    ASSERT_EQ(1, dropCount);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(5, 0)))).Times(1);
+
+    sendTestResponse(&router, 5, 0);
+    ASSERT_EQ(0, diypinball_featureRouter_transmitNext(&router));
+}
+
+TEST_F(diypinball_featureRouter_test, incoming_can_message_for_other_board_not_routed) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (43 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, incoming_broadcast_can_message_routed) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (0 << 24) | (DIYPINBALL_BROADCAST_ALL_BOARDS << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, incoming_group_can_message_routed_to_members_only) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+    diypinball_featureRouter_setGroupMask(&router, (1 << 0) | (1 << 31));
+    ASSERT_EQ((1 << 0) | (1 << 31), diypinball_featureRouter_getGroupMask(&router));
+
+    diypinball_canMessage_t message;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(2);
+
+    message.id = (3 << 25) | (0 << 24) | (1 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message.id = (3 << 25) | (0 << 24) | (2 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message.id = (3 << 25) | (0 << 24) | (32 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message.id = (3 << 25) | (0 << 24) | (33 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+static uint8_t filtersAccept(diypinball_canFilter_t *filters, uint8_t numFilters, uint32_t id) {
+    for(uint8_t i = 0; i < numFilters; i++) {
+        if((id & filters[i].mask) == (filters[i].id & filters[i].mask)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+TEST_F(diypinball_featureRouter_test, acceptance_filters_merge_feature_blocks) {
+    diypinball_featureHandlerInstance features[5];
+    uint8_t featureTypes[5] = {0, 1, 2, 3, 5};
+
+    for(uint8_t i = 0; i < 5; i++) {
+        features[i].featureType = featureTypes[i];
+        features[i].concreteFeatureHandlerInstance = NULL;
+        features[i].routerInstance = &router;
+        features[i].messageHandler = messageReceivedHandler1;
+        features[i].tickHandler = millisecondTickHandler1;
+        diypinball_featureRouter_addFeature(&router, &features[i]);
+    }
+
+    diypinball_canFilter_t filters[8];
+
+    ASSERT_EQ(4, diypinball_featureRouter_getAcceptanceFilters(&router, filters, 8));
+
+    ASSERT_EQ((1 << 24) | (42 << 16) | (0 << 12), filters[0].id);
+    ASSERT_EQ(0x01FFC000, filters[0].mask);
+    ASSERT_EQ((0 << 24) | (0 << 12), filters[1].id);
+    ASSERT_EQ(0x0100C000, filters[1].mask);
+    ASSERT_EQ((1 << 24) | (42 << 16) | (5 << 12), filters[2].id);
+    ASSERT_EQ(0x01FFF000, filters[2].mask);
+    ASSERT_EQ((0 << 24) | (5 << 12), filters[3].id);
+    ASSERT_EQ(0x0100F000, filters[3].mask);
+
+    for(uint8_t featureType = 0; featureType < 16; featureType++) {
+        uint8_t implemented = (featureType <= 3) || (featureType == 5);
+        ASSERT_EQ(implemented, filtersAccept(filters, 4, (7 << 25) | (1 << 24) | (42 << 16) | (featureType << 12) | 0xFFF));
+        ASSERT_EQ(implemented, filtersAccept(filters, 4, (7 << 25) | (0 << 24) | (43 << 16) | (featureType << 12) | 0xFFF));
+        ASSERT_EQ(0, filtersAccept(filters, 4, (7 << 25) | (1 << 24) | (43 << 16) | (featureType << 12) | 0xFFF));
+    }
+}
+
+TEST_F(diypinball_featureRouter_test, acceptance_filters_fall_back_when_out_of_slots) {
+    diypinball_featureHandlerInstance features[2];
+    uint8_t featureTypes[2] = {1, 3};
+
+    for(uint8_t i = 0; i < 2; i++) {
+        features[i].featureType = featureTypes[i];
+        features[i].concreteFeatureHandlerInstance = NULL;
+        features[i].routerInstance = &router;
+        features[i].messageHandler = messageReceivedHandler1;
+        features[i].tickHandler = millisecondTickHandler1;
+        diypinball_featureRouter_addFeature(&router, &features[i]);
+    }
+
+    diypinball_canFilter_t filters[3];
+
+    ASSERT_EQ(2, diypinball_featureRouter_getAcceptanceFilters(&router, filters, 3));
+    ASSERT_EQ((1 << 24) | (42 << 16), filters[0].id);
+    ASSERT_EQ(0x01FF0000, filters[0].mask);
+    ASSERT_EQ(0, filters[1].id);
+    ASSERT_EQ(0x01000000, filters[1].mask);
+
+    ASSERT_EQ(1, diypinball_featureRouter_getAcceptanceFilters(&router, filters, 1));
+    ASSERT_EQ(0, filters[0].mask);
+
+    ASSERT_EQ(0, diypinball_featureRouter_getAcceptanceFilters(&router, filters, 0));
+}
+
+MATCHER_P(PinballMessageViewEqual, message, "") {
+    return (diypinball_pinballMessageView_getPriority(arg) == message.priority) &&
+        (diypinball_pinballMessageView_getUnitSpecific(arg) == message.unitSpecific) &&
+        (diypinball_pinballMessageView_getBoardAddress(arg) == message.boardAddress) &&
+        (diypinball_pinballMessageView_getFeatureType(arg) == message.featureType) &&
+        (diypinball_pinballMessageView_getFeatureNum(arg) == message.featureNum) &&
+        (diypinball_pinballMessageView_getFunction(arg) == message.function) &&
+        (diypinball_pinballMessageView_getReserved(arg) == message.reserved) &&
+        (diypinball_pinballMessageView_getMessageType(arg) == message.messageType) &&
+        (diypinball_pinballMessageView_getDataLength(arg) == message.dataLength) &&
+        (memcmp(diypinball_pinballMessageView_getData(arg), message.data, message.dataLength) == 0);
+}
+
+TEST_F(diypinball_featureRouter_test, incoming_can_message_routed_to_view_handler) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_setViewHandler(&router, 1, messageViewReceivedHandler1));
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 2;
+    message.rtr = 1;
+    message.dlc = 2;
+    message.data[0] = 255;
+    message.data[1] = 127;
+
+    diypinball_pinballMessage_t pinballMessage;
+    pinballMessage.priority = 3;
+    pinballMessage.unitSpecific = 1;
+    pinballMessage.boardAddress = 42;
+    pinballMessage.featureType = 1;
+    pinballMessage.featureNum = 5;
+    pinballMessage.function = 6;
+    pinballMessage.reserved = 2;
+    pinballMessage.messageType = MESSAGE_REQUEST;
+    pinballMessage.dataLength = 2;
+    pinballMessage.data[0] = 255;
+    pinballMessage.data[1] = 127;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(0);
+    EXPECT_CALL(myHandler1, testMessageViewReceivedHandler((void*)&dummyContext1, PinballMessageViewEqual(pinballMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, message_view_decodes_to_pinball_message) {
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 1;
+    message.data[0] = 63;
+
+    diypinball_pinballMessageView_t view;
+    view.message = &message;
+
+    diypinball_pinballMessage_t expectedMessage;
+    expectedMessage.priority = 3;
+    expectedMessage.unitSpecific = 1;
+    expectedMessage.boardAddress = 42;
+    expectedMessage.featureType = 1;
+    expectedMessage.featureNum = 5;
+    expectedMessage.function = 6;
+    expectedMessage.reserved = 0;
+    expectedMessage.messageType = MESSAGE_COMMAND;
+    expectedMessage.dataLength = 1;
+    expectedMessage.data[0] = 63;
+
+    diypinball_pinballMessage_t decodedMessage;
+    diypinball_featureRouter_decodeMessageView(&view, &decodedMessage);
+
+    ASSERT_THAT(&decodedMessage, PinballMessageEqual(expectedMessage));
+}
+
+TEST_F(diypinball_featureRouter_test, view_handler_needs_feature_and_is_cleared_when_readded) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    ASSERT_EQ(RESULT_FAIL_INVALID_PARAMETER, diypinball_featureRouter_setViewHandler(&router, 1, messageViewReceivedHandler1));
+    ASSERT_EQ(RESULT_FAIL_INVALID_PARAMETER, diypinball_featureRouter_setViewHandler(&router, 16, messageViewReceivedHandler1));
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_setViewHandler(&router, 1, messageViewReceivedHandler1));
+    ASSERT_TRUE(router.viewHandlers[1] == messageViewReceivedHandler1);
+
+    // a handler that fills in the old struct and adds itself again gets the messageHandler
+    diypinball_featureRouter_addFeature(&router, &feature1);
+    ASSERT_TRUE(router.viewHandlers[1] == NULL);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 2;
+    message.rtr = 1;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageViewReceivedHandler(_, _)).Times(0);
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler((void*)&dummyContext1, _)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, millisecond_tick_skips_features_until_deadline) {
+    uint32_t dummyContext1, dummyContext2;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureHandlerInstance feature2;
+    feature2.featureType = 2;
+    feature2.concreteFeatureHandlerInstance = (void*) &dummyContext2;
+    feature2.routerInstance = &router;
+    feature2.messageHandler = messageReceivedHandler2;
+    feature2.tickHandler = millisecondTickHandler2;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+    diypinball_featureRouter_addFeature(&router, &feature2);
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler((void*)&dummyContext1, 0)).WillOnce(Return(5));
+    EXPECT_CALL(myHandler2, testMillisecondReceivedHandler((void*)&dummyContext2, 0)).WillOnce(Return(DIYPINBALL_TICK_NONE));
+
+    ASSERT_EQ(5, diypinball_featureRouter_millisecondTick(&router, 0));
+
+    ::testing::Mock::VerifyAndClearExpectations(&myHandler1);
+    ::testing::Mock::VerifyAndClearExpectations(&myHandler2);
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, _)).Times(0);
+    EXPECT_CALL(myHandler2, testMillisecondReceivedHandler(_, _)).Times(0);
+
+    for(uint32_t i = 1; i < 5; i++) {
+        ASSERT_EQ(5 - i, diypinball_featureRouter_millisecondTick(&router, i));
+    }
+
+    ::testing::Mock::VerifyAndClearExpectations(&myHandler1);
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler((void*)&dummyContext1, 5)).WillOnce(Return(DIYPINBALL_TICK_NONE));
+
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_featureRouter_millisecondTick(&router, 5));
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_featureRouter_millisecondTick(&router, 6));
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, routed_message_makes_feature_tick_due) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, 0)).WillOnce(Return(DIYPINBALL_TICK_NONE));
+    diypinball_featureRouter_millisecondTick(&router, 0);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(1);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0, diypinball_featureRouter_getTicksUntilDeadline(&router, 0));
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, 3)).WillOnce(Return(DIYPINBALL_TICK_NONE));
+    diypinball_featureRouter_millisecondTick(&router, 3);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, schedule_tick_brings_deadline_forward) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, 10)).WillOnce(Return(100));
+    diypinball_featureRouter_millisecondTick(&router, 10);
+    ASSERT_EQ(10, diypinball_featureRouter_getTick(&router));
+
+    diypinball_featureRouter_scheduleTick(&router, 1, 200);
+    ASSERT_EQ(100, diypinball_featureRouter_getTicksUntilDeadline(&router, 10));
+
+    diypinball_featureRouter_scheduleTick(&router, 1, 3);
+    ASSERT_EQ(3, diypinball_featureRouter_getTicksUntilDeadline(&router, 10));
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, 13)).WillOnce(Return(DIYPINBALL_TICK_NONE));
+    diypinball_featureRouter_millisecondTick(&router, 13);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+class MockTxQueueLock {
+public:
+    virtual ~MockTxQueueLock() {}
+    MOCK_METHOD0(testLockHandler, void());
+    MOCK_METHOD0(testUnlockHandler, void());
+};
+
+static MockTxQueueLock* TxQueueLockImpl;
+
+extern "C" {
+    static void testTxQueueLockHandler(void) {
+        TxQueueLockImpl->testLockHandler();
+    }
+
+    static void testTxQueueUnlockHandler(void) {
+        TxQueueLockImpl->testUnlockHandler();
+    }
+}
+
+TEST_F(diypinball_featureRouter_test, tx_queue_locked_while_changed_and_sent) {
+    MockTxQueueLock myTxQueueLock;
+    TxQueueLockImpl = &myTxQueueLock;
+
+    ASSERT_TRUE(NULL == router.txQueue.lockHandler);
+    ASSERT_TRUE(NULL == router.txQueue.unlockHandler);
+
+    diypinball_featureRouter_setTxQueueLockHandlers(&router, testTxQueueLockHandler, testTxQueueUnlockHandler);
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myTxQueueLock, testLockHandler()).Times(1);
+        EXPECT_CALL(myTxQueueLock, testUnlockHandler()).Times(1);
+        EXPECT_CALL(myTxQueueLock, testLockHandler()).Times(1);
+        EXPECT_CALL(myTxQueueLock, testUnlockHandler()).Times(1);
+        EXPECT_CALL(myTxQueueLock, testLockHandler()).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(3, 1)))).Times(1);
+        EXPECT_CALL(myTxQueueLock, testUnlockHandler()).Times(1);
+        EXPECT_CALL(myTxQueueLock, testLockHandler()).Times(1);
+        EXPECT_CALL(myTxQueueLock, testUnlockHandler()).Times(1);
+    }
+
+    diypinball_featureRouter_setTxQueueDepth(&router, 4);
+    sendTestResponse(&router, 3, 1);
+    ASSERT_EQ(1, diypinball_featureRouter_transmitNext(&router));
+    ASSERT_EQ(0, diypinball_featureRouter_transmitNext(&router));
+
+    ::testing::Mock::VerifyAndClearExpectations(&myTxQueueLock);
+
+    diypinball_featureRouter_deinit(&router);
+    ASSERT_TRUE(NULL == router.txQueue.lockHandler);
+    ASSERT_TRUE(NULL == router.txQueue.unlockHandler);
+
+    TxQueueLockImpl = NULL;
+}
+
+static uint32_t testTickSource;
+
+extern "C" {
+    static uint32_t testTickSourceHandler(void) {
+        return testTickSource;
+    }
+}
+
+TEST_F(diypinball_featureRouter_test, tick_source_keeps_current_tick_between_ticks) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, 10)).WillOnce(Return(DIYPINBALL_TICK_NONE));
+    diypinball_featureRouter_millisecondTick(&router, 10);
+
+    testTickSource = 500;
+    ASSERT_EQ(10, diypinball_featureRouter_getTick(&router));
+
+    diypinball_featureRouter_setTickSourceHandler(&router, testTickSourceHandler);
+    ASSERT_EQ(500, diypinball_featureRouter_getTick(&router));
+
+    // a deadline scheduled between ticks counts from the platform time, not the last tick passed in
+    diypinball_featureRouter_scheduleTick(&router, 1, 20);
+    ASSERT_EQ(20, diypinball_featureRouter_getTicksUntilDeadline(&router, 500));
+
+    diypinball_featureRouter_setTickSourceHandler(&router, NULL);
+    ASSERT_EQ(500, diypinball_featureRouter_getTick(&router));
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+static uint32_t testCycleCount;
+
+extern "C" {
+    static uint32_t testCycleCounterHandler(void) {
+        testCycleCount += 7;
+        return testCycleCount;
+    }
+}
+
+TEST_F(diypinball_featureRouter_test, statistics_count_traffic_per_feature) {
+    uint32_t dummyContext1;
+    diypinball_featureStatistics_t statistics;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(2);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (2 << 12) | (5 << 8) | (6 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    diypinball_featureRouter_reportUnknownFunction(&router, 1);
+
+    diypinball_featureRouter_setTxQueueDepth(&router, 1);
+    sendTestResponse(&router, 3, 0);
+    sendTestResponse(&router, 5, 0); // dropped
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_getStatistics(&router, 1, &statistics));
+    ASSERT_EQ(2, statistics.rxCount);
+    ASSERT_EQ(0, statistics.txCount);
+    ASSERT_EQ(0, statistics.dropCount);
+    ASSERT_EQ(1, statistics.unknownFunctionCount);
+    ASSERT_EQ(0, statistics.handlerCallCount);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_getStatistics(&router, 2, &statistics));
+    ASSERT_EQ(0, statistics.rxCount);
+    ASSERT_EQ(2, statistics.txCount);
+    ASSERT_EQ(2, statistics.dropCount);
+
+    ASSERT_EQ(RESULT_FAIL_INVALID_PARAMETER, diypinball_featureRouter_getStatistics(&router, 16, &statistics));
+
+    diypinball_featureRouter_resetStatistics(&router);
+    diypinball_featureRouter_getStatistics(&router, 1, &statistics);
+    ASSERT_EQ(0, statistics.rxCount);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+
+TEST_F(diypinball_featureRouter_test, statistics_time_message_handlers) {
+    uint32_t dummyContext1;
+    diypinball_featureStatistics_t statistics;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    testCycleCount = 0;
+    diypinball_featureRouter_setCycleCounterHandler(&router, testCycleCounterHandler);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(3);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    diypinball_featureRouter_getStatistics(&router, 1, &statistics);
+    ASSERT_EQ(3, statistics.handlerCallCount);
+    ASSERT_EQ(7, statistics.handlerCyclesMin);
+    ASSERT_EQ(7, statistics.handlerCyclesMax);
+    ASSERT_EQ(21, statistics.handlerCyclesTotal);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
+#endif
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE
+static uint8_t receivedBuffer[DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE];
+static uint16_t receivedBufferLength;
+static uint8_t receivedBufferCount;
+static diypinball_pinballMessage_t receivedBufferHeader;
+
+extern "C" {
+    static void bufferReceivedHandler1(void *featureHandlerInstance, diypinball_pinballMessage_t *header, const uint8_t *buffer, uint16_t length) {
+        receivedBufferHeader = *header;
+        memcpy(receivedBuffer, buffer, length);
+        receivedBufferLength = length;
+        receivedBufferCount++;
+    }
+}
+
+static diypinball_canMessage_t segmentFrame(uint8_t frameType, uint8_t dlc) {
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | frameType;
+    message.rtr = 0;
+    message.dlc = dlc;
+    memset(message.data, 0, 8);
+    return message;
+}
+
+static diypinball_canMessage_t segmentFirstFrame(uint16_t length) {
+    diypinball_canMessage_t message = segmentFrame(DIYPINBALL_SEGMENT_FIRST_FRAME, 8);
+    message.data[0] = (uint8_t) (length & 0xFF);
+    message.data[1] = (uint8_t) (length >> 8);
+    for(uint8_t i = 0; i < 6; i++) {
+        message.data[i + 2] = i;
+    }
+    return message;
+}
+
+static diypinball_canMessage_t segmentConsecutiveFrame(uint8_t sequence, uint8_t firstByte, uint8_t count) {
+    diypinball_canMessage_t message = segmentFrame(DIYPINBALL_SEGMENT_CONSECUTIVE_FRAME, count + 1);
+    message.data[0] = sequence;
+    for(uint8_t i = 0; i < count; i++) {
+        message.data[i + 1] = firstByte + i;
+    }
+    return message;
+}
+
+static diypinball_canMessage_t segmentFlowControl(uint8_t flowStatus, uint8_t blockSize, uint8_t separationTime) {
+    diypinball_canMessage_t message = segmentFrame(DIYPINBALL_SEGMENT_FLOW_CONTROL, 3);
+    message.data[0] = flowStatus;
+    message.data[1] = blockSize;
+    message.data[2] = separationTime;
+    return message;
+}
+
+class diypinball_featureRouter_segment_test : public diypinball_featureRouter_test {
+    protected:
+
+    virtual void SetUp() {
+        diypinball_featureRouter_test::SetUp();
+
+        feature1.featureType = 1;
+        feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+        feature1.routerInstance = &router;
+        feature1.messageHandler = messageReceivedHandler1;
+        feature1.tickHandler = millisecondTickHandler1;
+
+        diypinball_featureRouter_addFeature(&router, &feature1);
+        diypinball_featureRouter_setBufferHandler(&router, 1, bufferReceivedHandler1);
+
+        receivedBufferLength = 0;
+        receivedBufferCount = 0;
+    }
+
+    virtual void TearDown() {
+        Handler1 = NULL;
+        Handler2 = NULL;
+    }
+
+    uint32_t dummyContext1;
+    diypinball_featureHandlerInstance feature1;
+};
+
+TEST_F(diypinball_featureRouter_segment_test, segmented_transfer_reassembled_for_buffer_handler) {
+    diypinball_canMessage_t message;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(0);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 0, 0)))).Times(1);
+
+    message = segmentFirstFrame(20);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(1, 6, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    ASSERT_EQ(0, receivedBufferCount);
+    message = segmentConsecutiveFrame(2, 13, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(1, receivedBufferCount);
+    ASSERT_EQ(20, receivedBufferLength);
+    for(uint8_t i = 0; i < 20; i++) {
+        ASSERT_EQ(i, receivedBuffer[i]);
+    }
+    ASSERT_EQ(1, receivedBufferHeader.featureType);
+    ASSERT_EQ(5, receivedBufferHeader.featureNum);
+    ASSERT_EQ(6, receivedBufferHeader.function);
+    ASSERT_EQ(0, receivedBufferHeader.reserved);
+    ASSERT_EQ(MESSAGE_COMMAND, receivedBufferHeader.messageType);
+}
+
+TEST_F(diypinball_featureRouter_segment_test, oversized_segmented_transfer_refused) {
+    diypinball_canMessage_t message = segmentFirstFrame(DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE + 1);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_OVERFLOW, 0, 0)))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0, router.segmentRx.length);
+}
+
+TEST_F(diypinball_featureRouter_segment_test, other_reserved_values_routed_to_message_handler) {
+    diypinball_canMessage_t message = segmentFrame(0x0B, 2);
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    message = segmentFrame(0x0F, 2);
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).Times(1);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0, router.segmentRx.length);
+}
+
+#if DIYPINBALL_FEATUREROUTER_SEGMENT_BUFFER_SIZE >= 0x0100
+TEST_F(diypinball_featureRouter_segment_test, segmented_transfer_length_is_little_endian) {
+    diypinball_canMessage_t message = segmentFrame(DIYPINBALL_SEGMENT_FIRST_FRAME, 8);
+    message.data[0] = 0x00;
+    message.data[1] = 0x01;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 0, 0)))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0x0100, router.segmentRx.length);
+}
+#endif
+
+TEST_F(diypinball_featureRouter_segment_test, segmented_transfer_abandoned_on_sequence_error) {
+    diypinball_canMessage_t message;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+
+    message = segmentFirstFrame(20);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(2, 13, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(1, 6, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0, receivedBufferCount);
+    ASSERT_EQ(0, router.segmentRx.length);
+}
+
+TEST_F(diypinball_featureRouter_segment_test, segmented_transfer_abandoned_on_timeout) {
+    diypinball_canMessage_t message;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, _)).WillRepeatedly(Return(DIYPINBALL_TICK_NONE));
+
+    message = segmentFirstFrame(20);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT, diypinball_featureRouter_millisecondTick(&router, 0));
+    ASSERT_EQ(1, diypinball_featureRouter_millisecondTick(&router, DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT - 1));
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_featureRouter_millisecondTick(&router, DIYPINBALL_FEATUREROUTER_SEGMENT_TIMEOUT));
+    ASSERT_EQ(0, router.segmentRx.length);
+}
+
+TEST_F(diypinball_featureRouter_segment_test, segmented_transfer_flow_control_per_block) {
+    diypinball_canMessage_t message;
+
+    diypinball_featureRouter_setSegmentFlowControl(&router, 2, 5);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 2, 5)))).Times(2);
+
+    message = segmentFirstFrame(30);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(1, 6, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(2, 13, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(3, 20, 7);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    message = segmentConsecutiveFrame(4, 27, 3);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(1, receivedBufferCount);
+    ASSERT_EQ(30, receivedBufferLength);
+    ASSERT_EQ(29, receivedBuffer[29]);
+}
+
+static diypinball_pinballMessage_t segmentHeader(void) {
+    diypinball_pinballMessage_t header;
+    header.priority = 3;
+    header.unitSpecific = 1;
+    header.boardAddress = 0;
+    header.featureType = 1;
+    header.featureNum = 5;
+    header.function = 6;
+    header.reserved = 0;
+    header.messageType = MESSAGE_RESPONSE;
+    header.dataLength = 0;
+    return header;
+}
+
+TEST_F(diypinball_featureRouter_segment_test, short_buffer_sent_as_single_frame) {
+    diypinball_pinballMessage_t header = segmentHeader();
+    uint8_t buffer[3] = {1, 2, 3};
+    diypinball_canMessage_t expected = segmentFrame(0, 3);
+    expected.data[0] = 1;
+    expected.data[1] = 2;
+    expected.data[2] = 3;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expected))).Times(1);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 3));
+}
+
+// the frame layouts below assume classic CAN frames
+#if !DIYPINBALL_CAN_FD
+TEST_F(diypinball_featureRouter_segment_test, long_buffer_sent_after_flow_control) {
+    diypinball_pinballMessage_t header = segmentHeader();
+    diypinball_canMessage_t message;
+    uint8_t buffer[20];
+
+    for(uint8_t i = 0; i < 20; i++) {
+        buffer[i] = i;
+    }
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentFirstFrame(20)))).Times(1);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 20));
+    ASSERT_EQ(RESULT_FAIL_QUEUE_FULL, diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 20));
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(1, 6, 7)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(2, 13, 7)))).Times(1);
+    }
+
+    message = segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 0, 0);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0, router.segmentTx.length);
+}
+
+TEST_F(diypinball_featureRouter_segment_test, long_buffer_paced_by_separation_time) {
+    diypinball_pinballMessage_t header = segmentHeader();
+    diypinball_canMessage_t message;
+    uint8_t buffer[20];
+
+    for(uint8_t i = 0; i < 20; i++) {
+        buffer[i] = i;
+    }
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, _)).WillRepeatedly(Return(DIYPINBALL_TICK_NONE));
+    diypinball_featureRouter_millisecondTick(&router, 100);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+    diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 20);
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(1, 6, 7)))).Times(1);
+    message = segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 0, 5);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    ASSERT_EQ(1, diypinball_featureRouter_millisecondTick(&router, 104));
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(2, 13, 7)))).Times(1);
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_featureRouter_millisecondTick(&router, 105));
+}
+
+TEST_F(diypinball_featureRouter_segment_test, long_buffer_waits_for_tx_queue_slots) {
+    diypinball_pinballMessage_t header = segmentHeader();
+    diypinball_canMessage_t message;
+    uint8_t buffer[40];
+
+    for(uint8_t i = 0; i < 40; i++) {
+        buffer[i] = i;
+    }
+
+    EXPECT_CALL(myHandler1, testMillisecondReceivedHandler(_, _)).WillRepeatedly(Return(DIYPINBALL_TICK_NONE));
+    diypinball_featureRouter_millisecondTick(&router, 100);
+
+    diypinball_featureRouter_setTxQueueDepth(&router, 4);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 40));
+    message = segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 0, 0);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    // the first frame and three consecutive frames fill the queue, the last two wait
+    ASSERT_EQ(4, router.txQueue.count);
+    ASSERT_EQ(27, router.segmentTx.sent);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentFirstFrame(40)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(1, 6, 7)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(2, 13, 7)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(3, 20, 7)))).Times(1);
+    }
+
+    while(diypinball_featureRouter_transmitNext(&router));
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(4, 27, 7)))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(segmentConsecutiveFrame(5, 34, 6)))).Times(1);
+    }
+
+    diypinball_featureRouter_millisecondTick(&router, 101);
+    while(diypinball_featureRouter_transmitNext(&router));
+
+    ASSERT_EQ(0, router.segmentTx.length);
+}
+
+TEST_F(diypinball_featureRouter_segment_test, long_buffer_abandoned_when_tx_queue_evicts_a_frame) {
+    diypinball_pinballMessage_t header = segmentHeader();
+    diypinball_canMessage_t message;
+    uint8_t buffer[40] = {0};
+
+    diypinball_featureRouter_setTxQueueDepth(&router, 2);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 40));
+    message = segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_CONTINUE, 0, 0);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(2, router.txQueue.count);
+    ASSERT_EQ(40, router.segmentTx.length);
+    ASSERT_EQ(RESULT_FAIL_QUEUE_FULL, diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 40));
+
+    // a more urgent message pushes out the consecutive frame
+    sendTestResponse(&router, 1, 0);
+
+    ASSERT_EQ(0, router.segmentTx.length);
+}
+
+#endif
+
+TEST_F(diypinball_featureRouter_segment_test, long_buffer_abandoned_on_overflow) {
+    diypinball_pinballMessage_t header = segmentHeader();
+    diypinball_canMessage_t message;
+    uint8_t buffer[20] = {0};
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+    diypinball_featureRouter_sendPinballBuffer(&router, &header, buffer, 20);
+
+    message = segmentFlowControl(DIYPINBALL_SEGMENT_FLOW_OVERFLOW, 0, 0);
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    ASSERT_EQ(0, router.segmentTx.length);
+}
+#endif
+
+#if DIYPINBALL_CAN_FD
+TEST_F(diypinball_featureRouter_test, fd_message_padded_to_next_data_length_code) {
+    diypinball_pinballMessage_t pinballMessage;
+    pinballMessage.priority = 3;
+    pinballMessage.unitSpecific = 1;
+    pinballMessage.boardAddress = 0;
+    pinballMessage.featureType = 2;
+    pinballMessage.featureNum = 0;
+    pinballMessage.function = 6;
+    pinballMessage.reserved = 0;
+    pinballMessage.messageType = MESSAGE_RESPONSE;
+    pinballMessage.dataLength = 10;
+    memset(pinballMessage.data, 0xAA, sizeof(pinballMessage.data));
+
+    diypinball_canMessage_t expectedCANMessage = expectedTestResponse(3, 0);
+    expectedCANMessage.dlc = 9;
+    memset(expectedCANMessage.data, 0xAA, 10);
+    expectedCANMessage.data[10] = 0;
+    expectedCANMessage.data[11] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_sendPinballMessage(&router, &pinballMessage);
+
+    ASSERT_EQ(12, diypinball_dlcToLength(9));
+    ASSERT_EQ(64, diypinball_dlcToLength(15));
+    ASSERT_EQ(14, diypinball_lengthToDlc(33));
+}
+#endif
+
+class MockCANSendBatch {
+public:
+    virtual ~MockCANSendBatch() {}
+    MOCK_METHOD2(testCanSendBatchHandler, void(diypinball_canMessage_t*, size_t));
+};
+
+static MockCANSendBatch* CANSendBatchImpl;
+
+extern "C" {
+    static void testCanSendBatchHandler(diypinball_canMessage_t *messages, size_t count) {
+        CANSendBatchImpl->testCanSendBatchHandler(messages, count);
+    }
+}
+
+class diypinball_featureRouter_batch_test : public diypinball_featureRouter_test {
+    protected:
+
+    virtual void SetUp() {
+        diypinball_featureRouter_test::SetUp();
+        CANSendBatchImpl = &myCANSendBatch;
+
+        diypinball_featureRouterInit_t routerInit;
+
+        routerInit.boardAddress = 42;
+        routerInit.canSendHandler = testCanSendHandler;
+
+        diypinball_featureRouter_init(&router, &routerInit);
+        diypinball_featureRouter_setCanSendBatchHandler(&router, testCanSendBatchHandler);
+    }
+
+    MockCANSendBatch myCANSendBatch;
+};
+
+TEST_F(diypinball_featureRouter_batch_test, batch_gathers_messages_until_closed) {
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_beginBatch(&router);
+    diypinball_featureRouter_beginBatch(&router);
+    sendTestResponse(&router, 3, 0);
+    sendTestResponse(&router, 4, 0);
+    diypinball_featureRouter_endBatch(&router);
+    sendTestResponse(&router, 5, 0);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSendBatch);
+
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, 3)).Times(1);
+
+    diypinball_featureRouter_endBatch(&router);
+}
+
+TEST_F(diypinball_featureRouter_batch_test, full_batch_sent_early) {
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE)).Times(1);
+        EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, 1)).Times(1);
+    }
+
+    diypinball_featureRouter_beginBatch(&router);
+    for(uint8_t i = 0; i <= DIYPINBALL_FEATUREROUTER_TX_BATCH_SIZE; i++) {
+        sendTestResponse(&router, 3, 0);
+    }
+    diypinball_featureRouter_endBatch(&router);
+}
+
+TEST_F(diypinball_featureRouter_batch_test, messages_outside_batch_sent_directly) {
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedTestResponse(3, 0)))).Times(1);
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_endBatch(&router);
+    sendTestResponse(&router, 3, 0);
+}
+
+TEST_F(diypinball_featureRouter_batch_test, messages_outside_batch_use_batch_handler_without_send_handler) {
+    router.canSendHandler = NULL;
+
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, 1)).Times(1);
+
+    sendTestResponse(&router, 3, 0);
+}
+
+TEST_F(diypinball_featureRouter_batch_test, tx_queue_uses_batch_handler_without_send_handler) {
+    router.canSendHandler = NULL;
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_setTxQueueDepth(&router, 4));
+
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, _)).Times(0);
+
+    sendTestResponse(&router, 3, 0);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSendBatch);
+
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, 1)).Times(1);
+
+    ASSERT_EQ(1, diypinball_featureRouter_transmitNext(&router));
+    ASSERT_EQ(0, diypinball_featureRouter_transmitNext(&router));
+}
+
+TEST_F(diypinball_featureRouter_batch_test, dispatch_sends_replies_as_one_batch) {
+    uint32_t dummyContext1;
+
+    diypinball_featureHandlerInstance feature1;
+    feature1.featureType = 1;
+    feature1.concreteFeatureHandlerInstance = (void*) &dummyContext1;
+    feature1.routerInstance = &router;
+    feature1.messageHandler = messageReceivedHandler1;
+    feature1.tickHandler = millisecondTickHandler1;
+
+    diypinball_featureRouter_addFeature(&router, &feature1);
+
+    diypinball_canMessage_t message;
+    message.id = (3 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (6 << 4) | 0;
+    message.rtr = 0;
+    message.dlc = 0;
+
+    diypinball_featureRouterInstance_t *routerInstance = &router;
+
+    EXPECT_CALL(myHandler1, testMessageReceivedHandler(_, _)).WillOnce(::testing::InvokeWithoutArgs([routerInstance]() {
+        sendTestResponse(routerInstance, 3, 0);
+        sendTestResponse(routerInstance, 3, 1);
+    }));
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(myCANSendBatch, testCanSendBatchHandler(_, 2)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &message);
+
+    Handler1 = NULL;
+    Handler2 = NULL;
+}
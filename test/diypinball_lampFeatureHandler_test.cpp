@@ -540,6 +540,30 @@ TEST_F(diypinball_lampFeatureHandler_test, message_to_function_1_to_low_set_chan
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+TEST_F(diypinball_lampFeatureHandler_test, message_to_function_1_is_not_an_unknown_function)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_featureStatistics_t statistics;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (2 << 12) | (0 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 8;
+    for(uint8_t i = 0; i < 8; i++) {
+        initiatingCANMessage.data[i] = 16;
+    }
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(myLampFeatureHandlerHandlers, testLampChangedHandler(_, _)).Times(8);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_getStatistics(&router, 2, &statistics));
+    ASSERT_EQ(1, statistics.rxCount);
+    ASSERT_EQ(0, statistics.unknownFunctionCount);
+}
+#endif
+
 TEST_F(diypinball_lampFeatureHandler_test, message_to_function_1_to_high_set_changes_lamps)
 {
     diypinball_canMessage_t initiatingCANMessage;
@@ -628,6 +652,35 @@ TEST_F(diypinball_lampFeatureHandler_test, message_to_function_1_to_high_set_cha
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
+#if DIYPINBALL_CAN_FD
+TEST_F(diypinball_lampFeatureHandler_test, message_to_function_1_fd_frame_changes_both_sets)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (2 << 12) | (0 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = diypinball_lengthToDlc(16);
+
+    diypinball_lampStatus_t expectedLamp;
+    expectedLamp.state1Duration = 0;
+    expectedLamp.state2 = 0;
+    expectedLamp.state2Duration = 0;
+    expectedLamp.state3 = 0;
+    expectedLamp.state3Duration = 0;
+    expectedLamp.numStates = 1;
+
+    InSequence dummy;
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    for(uint8_t i = 0; i < 16; i++) {
+        initiatingCANMessage.data[i] = i + 1;
+        expectedLamp.state1 = i + 1;
+        EXPECT_CALL(myLampFeatureHandlerHandlers, testLampChangedHandler(i, LampStatusEqual(expectedLamp))).Times(1);
+    }
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+#endif
+
 TEST_F(diypinball_lampFeatureHandler_test, message_to_function_1_to_low_set_with_no_data_does_nothing)
 {
     diypinball_canMessage_t initiatingCANMessage;
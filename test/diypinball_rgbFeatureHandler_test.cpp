@@ -361,6 +361,30 @@ TEST_F(diypinball_rgbFeatureHandler_test, message_to_function_1_to_low_set_chang
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+TEST_F(diypinball_rgbFeatureHandler_test, message_to_function_1_is_not_an_unknown_function)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_featureStatistics_t statistics;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (5 << 12) | (0 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 8;
+    for(uint8_t i = 0; i < 8; i++) {
+        initiatingCANMessage.data[i] = 16;
+    }
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(myRGBFeatureHandlerHandlers, testRGBChangedHandler(_, _)).Times(8);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_getStatistics(&router, 5, &statistics));
+    ASSERT_EQ(1, statistics.rxCount);
+    ASSERT_EQ(0, statistics.unknownFunctionCount);
+}
+#endif
+
 TEST_F(diypinball_rgbFeatureHandler_test, message_to_function_1_to_low_set_changes_greens_on_rgbs)
 {
     diypinball_canMessage_t initiatingCANMessage;
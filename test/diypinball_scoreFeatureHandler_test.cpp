@@ -118,7 +118,8 @@ TEST_F(diypinball_scoreFeatureHandler_test, request_to_feature_0_gets_display_bl
 
         expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (4 << 12) | (i << 8) | (0 << 4) | 0;
         expectedCANMessage.rtr = 0;
-        expectedCANMessage.dlc = 8;
+        expectedCANMessage.dlc = diypinball_lengthToDlc(DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH);
+        memset(expectedCANMessage.data, 0, sizeof(expectedCANMessage.data));
         expectedCANMessage.data[0] = 0;
         expectedCANMessage.data[1] = 0;
         expectedCANMessage.data[2] = 0;
@@ -221,7 +222,8 @@ TEST_F(diypinball_scoreFeatureHandler_test, request_to_feature_0_gets_display_wh
 
         expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (4 << 12) | (i << 8) | (0 << 4) | 0;
         expectedCANMessage.rtr = 0;
-        expectedCANMessage.dlc = 8;
+        expectedCANMessage.dlc = diypinball_lengthToDlc(DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH);
+        memset(expectedCANMessage.data, 0, sizeof(expectedCANMessage.data));
         expectedCANMessage.data[0] = 15;
         expectedCANMessage.data[1] = 16;
         expectedCANMessage.data[2] = 32;
@@ -268,7 +270,8 @@ TEST_F(diypinball_scoreFeatureHandler_test, request_to_feature_0_gets_display_wh
 
         expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (4 << 12) | (i << 8) | (0 << 4) | 0;
         expectedCANMessage.rtr = 0;
-        expectedCANMessage.dlc = 8;
+        expectedCANMessage.dlc = diypinball_lengthToDlc(DIYPINBALL_SCOREFEATUREHANDLER_DISPLAY_LENGTH);
+        memset(expectedCANMessage.data, 0, sizeof(expectedCANMessage.data));
         expectedCANMessage.data[0] = 15;
         expectedCANMessage.data[1] = 16;
         expectedCANMessage.data[2] = 32;
@@ -346,6 +349,33 @@ TEST_F(diypinball_scoreFeatureHandler_test, message_to_feature_1_with_data_sets_
     }
 }
 
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+TEST_F(diypinball_scoreFeatureHandler_test, message_and_request_to_feature_1_are_not_unknown_functions)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_featureStatistics_t statistics;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (4 << 12) | (0 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 142;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+    EXPECT_CALL(myScoreFeatureHandlerHandlers, testBrightnessChangedHandler(142)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_getStatistics(&router, 4, &statistics));
+    ASSERT_EQ(2, statistics.rxCount);
+    ASSERT_EQ(0, statistics.unknownFunctionCount);
+}
+#endif
+
 TEST_F(diypinball_scoreFeatureHandler_test, set_and_retrieve_brightness)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
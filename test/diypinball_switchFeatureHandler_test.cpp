@@ -17,7 +17,10 @@ class MockSwitchFeatureHandlerHandlers {
 public:
     virtual ~MockSwitchFeatureHandlerHandlers() {}
     MOCK_METHOD2(testReadStateHandler, void(uint8_t*, uint8_t));
+    MOCK_METHOD2(testReadAllStatesHandler, void(uint16_t*, uint8_t));
     MOCK_METHOD2(testDebounceChangedHandler, void(uint8_t, uint8_t));
+    MOCK_METHOD3(testBulkDebounceChangedHandler, void(uint8_t, uint16_t, uint8_t));
+    MOCK_METHOD2(testCoilStateHandler, void(uint8_t, uint8_t));
 };
 
 static MockCANSend* CANSendImpl;
@@ -32,6 +35,14 @@ extern "C" {
         SwitchFeatureHandlerHandlersImpl->testDebounceChangedHandler(switchNum, debounceLimit);
     }
 
+    static void testBulkDebounceChangedHandler(uint8_t bank, uint16_t switchMask, uint8_t debounceLimit) {
+        SwitchFeatureHandlerHandlersImpl->testBulkDebounceChangedHandler(bank, switchMask, debounceLimit);
+    }
+
+    static void testCoilStateHandler(uint8_t coilNum, uint8_t state) {
+        SwitchFeatureHandlerHandlersImpl->testCoilStateHandler(coilNum, state);
+    }
+
     static void testReadStateHandler(uint8_t *state, uint8_t switchNum) {
         SwitchFeatureHandlerHandlersImpl->testReadStateHandler(state, switchNum);
         if(switchNum == 0) {
@@ -41,6 +52,24 @@ extern "C" {
         }
     }
 
+    static void testReadAllStatesHandler(uint16_t *states, uint8_t bank) {
+        SwitchFeatureHandlerHandlersImpl->testReadAllStatesHandler(states, bank);
+        // odd switches closed, plus bits for switches that don't exist
+        *states = 0xAAAA;
+    }
+
+    static uint32_t testTimestamp;
+
+    static uint32_t testTimestampHandler(void) {
+        return testTimestamp;
+    }
+
+    static uint32_t testTickSource;
+
+    static uint32_t testTickSourceHandler(void) {
+        return testTickSource;
+    }
+
     static void testReadStateHandlerZero(uint8_t *state, uint8_t switchNum) {
         SwitchFeatureHandlerHandlersImpl->testReadStateHandler(state, switchNum);
         *state = 0;
@@ -75,6 +104,7 @@ class diypinball_switchFeatureHandler_test : public testing::Test {
         switchFeatureHandlerInit.numSwitches = 15;
         switchFeatureHandlerInit.debounceChangedHandler = testDebounceChangedHandler;
         switchFeatureHandlerInit.readStateHandler = testReadStateHandler;
+        switchFeatureHandlerInit.readAllStatesHandler = NULL;
         switchFeatureHandlerInit.routerInstance = &router;
 
         diypinball_switchFeatureHandler_init(&switchFeatureHandler, &switchFeatureHandlerInit);
@@ -90,13 +120,46 @@ TEST_F(diypinball_switchFeatureHandler_test, init_zeros_structure)
 {
     ASSERT_EQ(1, switchFeatureHandler.featureHandlerInstance.featureType);
 
-    for(uint8_t i = 0; i < 16; i++) {
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].lastState);
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].messageTriggerMask);
+    ASSERT_EQ(0, switchFeatureHandler.switchState[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingBanks);
+    ASSERT_EQ(0, switchFeatureHandler.nextPollTick);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.deltaReportWindow);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaBanks);
+    ASSERT_TRUE(NULL == switchFeatureHandler.localCoils);
+    ASSERT_TRUE(NULL == switchFeatureHandler.timestampHandler);
+    ASSERT_EQ(0, switchFeatureHandler.actionSwitchMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.journalCount);
+    ASSERT_EQ(0, switchFeatureHandler.journalSequence);
+    ASSERT_EQ(0, switchFeatureHandler.reportJournalSequence);
+    ASSERT_EQ(0, switchFeatureHandler.replayCount);
+    ASSERT_EQ(0, switchFeatureHandler.chatterLimit);
+    ASSERT_EQ(0, switchFeatureHandler.chatterWindow);
+    ASSERT_EQ(0, switchFeatureHandler.stuckLimit);
+    ASSERT_EQ(0, switchFeatureHandler.chatterMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.chatterBanks);
+    ASSERT_EQ(0, switchFeatureHandler.stuckMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.stuckCheckPending);
+
+    for(uint8_t i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        ASSERT_EQ(DIYPINBALL_SWITCHACTION_NONE, switchFeatureHandler.actions[i].type);
+        ASSERT_EQ(0, switchFeatureHandler.actions[i].eventMask);
+        ASSERT_EQ(0, switchFeatureHandler.actions[i].boardAddress);
+    }
+
+    for(uint8_t i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES; i++) {
         ASSERT_EQ(0, switchFeatureHandler.switches[i].lastTick);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].pollingInterval);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].debounceLimit);
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].ruleMask);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].eventTime);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeTick);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].chatterCount);
+        ASSERT_EQ(DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY, switchFeatureHandler.switches[i].reportPriority);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.boardAddress);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.solenoidNum);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.attackStatus);
@@ -109,13 +172,23 @@ TEST_F(diypinball_switchFeatureHandler_test, init_zeros_structure)
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.attackDuration);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.sustainStatus);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.sustainDuration);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.frame.id);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.frame.dlc);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.frame.id);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.frame.dlc);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.cooldown);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.suppressedCount);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.cooldown);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.suppressedCount);
     }
 
     ASSERT_EQ(&router, switchFeatureHandler.featureHandlerInstance.routerInstance);
     ASSERT_EQ(&switchFeatureHandler, switchFeatureHandler.featureHandlerInstance.concreteFeatureHandlerInstance);
     ASSERT_EQ(15, switchFeatureHandler.numSwitches);
     ASSERT_TRUE(testReadStateHandler == switchFeatureHandler.readStateHandler);
+    ASSERT_TRUE(NULL == switchFeatureHandler.readAllStatesHandler);
     ASSERT_TRUE(testDebounceChangedHandler == switchFeatureHandler.debounceChangedHandler);
+    ASSERT_TRUE(NULL == switchFeatureHandler.bulkDebounceChangedHandler);
     ASSERT_TRUE(diypinball_switchFeatureHandler_millisecondTickHandler == switchFeatureHandler.featureHandlerInstance.tickHandler);
     ASSERT_TRUE(diypinball_switchFeatureHandler_messageReceivedHandler == switchFeatureHandler.featureHandlerInstance.messageHandler);
 }
@@ -126,13 +199,46 @@ TEST_F(diypinball_switchFeatureHandler_test, deinit_zeros_structure)
 
     ASSERT_EQ(0, switchFeatureHandler.featureHandlerInstance.featureType);
 
-    for(uint8_t i = 0; i < 16; i++) {
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].lastState);
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].messageTriggerMask);
+    ASSERT_EQ(0, switchFeatureHandler.switchState[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingBanks);
+    ASSERT_EQ(0, switchFeatureHandler.nextPollTick);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.deltaReportWindow);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaBanks);
+    ASSERT_TRUE(NULL == switchFeatureHandler.localCoils);
+    ASSERT_TRUE(NULL == switchFeatureHandler.timestampHandler);
+    ASSERT_EQ(0, switchFeatureHandler.actionSwitchMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.journalCount);
+    ASSERT_EQ(0, switchFeatureHandler.journalSequence);
+    ASSERT_EQ(0, switchFeatureHandler.reportJournalSequence);
+    ASSERT_EQ(0, switchFeatureHandler.replayCount);
+    ASSERT_EQ(0, switchFeatureHandler.chatterLimit);
+    ASSERT_EQ(0, switchFeatureHandler.chatterWindow);
+    ASSERT_EQ(0, switchFeatureHandler.stuckLimit);
+    ASSERT_EQ(0, switchFeatureHandler.chatterMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.chatterBanks);
+    ASSERT_EQ(0, switchFeatureHandler.stuckMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.stuckCheckPending);
+
+    for(uint8_t i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        ASSERT_EQ(DIYPINBALL_SWITCHACTION_NONE, switchFeatureHandler.actions[i].type);
+        ASSERT_EQ(0, switchFeatureHandler.actions[i].eventMask);
+        ASSERT_EQ(0, switchFeatureHandler.actions[i].boardAddress);
+    }
+
+    for(uint8_t i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES; i++) {
         ASSERT_EQ(0, switchFeatureHandler.switches[i].lastTick);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].pollingInterval);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].debounceLimit);
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].ruleMask);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].eventTime);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeTick);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].chatterCount);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].reportPriority);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.boardAddress);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.solenoidNum);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.attackStatus);
@@ -145,13 +251,23 @@ TEST_F(diypinball_switchFeatureHandler_test, deinit_zeros_structure)
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.attackDuration);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.sustainStatus);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.sustainDuration);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.frame.id);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.frame.dlc);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.frame.id);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.frame.dlc);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.cooldown);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.suppressedCount);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.cooldown);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.suppressedCount);
     }
 
     ASSERT_EQ(NULL, switchFeatureHandler.featureHandlerInstance.routerInstance);
     ASSERT_EQ(NULL, switchFeatureHandler.featureHandlerInstance.concreteFeatureHandlerInstance);
     ASSERT_EQ(0, switchFeatureHandler.numSwitches);
     ASSERT_TRUE(NULL == switchFeatureHandler.readStateHandler);
+    ASSERT_TRUE(NULL == switchFeatureHandler.readAllStatesHandler);
     ASSERT_TRUE(NULL == switchFeatureHandler.debounceChangedHandler);
+    ASSERT_TRUE(NULL == switchFeatureHandler.bulkDebounceChangedHandler);
     ASSERT_TRUE(NULL == switchFeatureHandler.featureHandlerInstance.tickHandler);
     ASSERT_TRUE(NULL == switchFeatureHandler.featureHandlerInstance.messageHandler);
 }
@@ -169,22 +285,56 @@ TEST(diypinball_switchFeatureHandler_test_other, init_too_many_switches)
     diypinball_switchFeatureHandlerInstance_t switchFeatureHandler;
     diypinball_switchFeatureHandlerInit_t switchFeatureHandlerInit;
 
-    switchFeatureHandlerInit.numSwitches = 17;
+    switchFeatureHandlerInit.numSwitches = DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES + 1;
     switchFeatureHandlerInit.debounceChangedHandler = testDebounceChangedHandler;
     switchFeatureHandlerInit.readStateHandler = testReadStateHandler;
+    switchFeatureHandlerInit.readAllStatesHandler = NULL;
     switchFeatureHandlerInit.routerInstance = &router;
 
     diypinball_switchFeatureHandler_init(&switchFeatureHandler, &switchFeatureHandlerInit);
 
     ASSERT_EQ(1, switchFeatureHandler.featureHandlerInstance.featureType);
 
-    for(uint8_t i = 0; i < 16; i++) {
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].lastState);
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].messageTriggerMask);
+    ASSERT_EQ(0, switchFeatureHandler.switchState[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingBanks);
+    ASSERT_EQ(0, switchFeatureHandler.nextPollTick);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.deltaReportWindow);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaBanks);
+    ASSERT_TRUE(NULL == switchFeatureHandler.localCoils);
+    ASSERT_TRUE(NULL == switchFeatureHandler.timestampHandler);
+    ASSERT_EQ(0, switchFeatureHandler.actionSwitchMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.journalCount);
+    ASSERT_EQ(0, switchFeatureHandler.journalSequence);
+    ASSERT_EQ(0, switchFeatureHandler.reportJournalSequence);
+    ASSERT_EQ(0, switchFeatureHandler.replayCount);
+    ASSERT_EQ(0, switchFeatureHandler.chatterLimit);
+    ASSERT_EQ(0, switchFeatureHandler.chatterWindow);
+    ASSERT_EQ(0, switchFeatureHandler.stuckLimit);
+    ASSERT_EQ(0, switchFeatureHandler.chatterMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.chatterBanks);
+    ASSERT_EQ(0, switchFeatureHandler.stuckMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.stuckCheckPending);
+
+    for(uint8_t i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT; i++) {
+        ASSERT_EQ(DIYPINBALL_SWITCHACTION_NONE, switchFeatureHandler.actions[i].type);
+        ASSERT_EQ(0, switchFeatureHandler.actions[i].eventMask);
+        ASSERT_EQ(0, switchFeatureHandler.actions[i].boardAddress);
+    }
+
+    for(uint8_t i = 0; i < DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES; i++) {
         ASSERT_EQ(0, switchFeatureHandler.switches[i].lastTick);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].pollingInterval);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].debounceLimit);
-        ASSERT_EQ(0, switchFeatureHandler.switches[i].ruleMask);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].eventTime);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeTick);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].chatterCount);
+        ASSERT_EQ(DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY, switchFeatureHandler.switches[i].reportPriority);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.boardAddress);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.solenoidNum);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.attackStatus);
@@ -197,13 +347,23 @@ TEST(diypinball_switchFeatureHandler_test_other, init_too_many_switches)
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.attackDuration);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.sustainStatus);
         ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.sustainDuration);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.frame.id);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.frame.dlc);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.frame.id);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.frame.dlc);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.cooldown);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].closeRule.suppressedCount);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.cooldown);
+        ASSERT_EQ(0, switchFeatureHandler.switches[i].openRule.suppressedCount);
     }
 
     ASSERT_EQ(&router, switchFeatureHandler.featureHandlerInstance.routerInstance);
     ASSERT_EQ(&switchFeatureHandler, switchFeatureHandler.featureHandlerInstance.concreteFeatureHandlerInstance);
-    ASSERT_EQ(16, switchFeatureHandler.numSwitches);
+    ASSERT_EQ(DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES, switchFeatureHandler.numSwitches);
     ASSERT_TRUE(testReadStateHandler == switchFeatureHandler.readStateHandler);
+    ASSERT_TRUE(NULL == switchFeatureHandler.readAllStatesHandler);
     ASSERT_TRUE(testDebounceChangedHandler == switchFeatureHandler.debounceChangedHandler);
+    ASSERT_TRUE(NULL == switchFeatureHandler.bulkDebounceChangedHandler);
     ASSERT_TRUE(diypinball_switchFeatureHandler_millisecondTickHandler == switchFeatureHandler.featureHandlerInstance.tickHandler);
     ASSERT_TRUE(diypinball_switchFeatureHandler_messageReceivedHandler == switchFeatureHandler.featureHandlerInstance.messageHandler);
 }
@@ -485,6 +645,190 @@ TEST_F(diypinball_switchFeatureHandler_test, switch_status_polling)
     diypinball_featureRouter_millisecondTick(&router, 10);
 }
 
+TEST_F(diypinball_switchFeatureHandler_test, millisecond_tick_returns_ticks_until_next_poll)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_switchFeatureHandler_millisecondTickHandler(&switchFeatureHandler, 0));
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 10;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.data[0] = 4;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0006, switchFeatureHandler.pollingMask[0]);
+    ASSERT_EQ(4, switchFeatureHandler.nextPollTick);
+
+    ASSERT_EQ(1, diypinball_switchFeatureHandler_millisecondTickHandler(&switchFeatureHandler, 3));
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, 2)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+
+    ASSERT_EQ(4, diypinball_switchFeatureHandler_millisecondTickHandler(&switchFeatureHandler, 6));
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, switches_due_on_same_tick_share_one_poll_report)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+    uint8_t i;
+
+    switchFeatureHandler.readStateHandler = testReadStateHandlerAll;
+
+    for(i = 0; i < 4; i++) {
+        initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (i << 8) | (1 << 4) | 0;
+        initiatingCANMessage.rtr = 0;
+        initiatingCANMessage.dlc = 1;
+        initiatingCANMessage.data[0] = (i < 3) ? 10 : 15;
+
+        diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    }
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+
+    ASSERT_EQ(10, diypinball_featureRouter_millisecondTick(&router, 0));
+    ASSERT_EQ(1, diypinball_featureRouter_millisecondTick(&router, 9));
+
+    // switches 0 to 2 come due together, 1 is closed
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 0x02;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x07;
+    expectedCANMessage.data[3] = 0x00;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(3);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    ASSERT_EQ(5, diypinball_featureRouter_millisecondTick(&router, 10));
+    ASSERT_EQ(0x0002, switchFeatureHandler.switchState[0]);
+
+    // switch 3 alone keeps the single switch status message
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (0 << 4) | 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, 3)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    ASSERT_EQ(5, diypinball_featureRouter_millisecondTick(&router, 15));
+    ASSERT_EQ(0x000A, switchFeatureHandler.switchState[0]);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, read_all_states_handler_reads_poll_group_at_once)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+    uint8_t i;
+
+    switchFeatureHandler.readAllStatesHandler = testReadAllStatesHandler;
+
+    for(i = 0; i < 3; i++) {
+        initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (i << 8) | (1 << 4) | 0;
+        initiatingCANMessage.rtr = 0;
+        initiatingCANMessage.dlc = 1;
+        initiatingCANMessage.data[0] = (i < 2) ? 10 : 15;
+
+        diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    }
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 0x02;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x03;
+    expectedCANMessage.data[3] = 0x00;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadAllStatesHandler(_, 0)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 10);
+    ASSERT_EQ(0x0002, switchFeatureHandler.switchState[0]);
+
+    // a single switch due reads the bank too, but keeps the single switch status message
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (0 << 4) | 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 0;
+    expectedCANMessage.data[1] = 0;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadAllStatesHandler(_, 0)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 15);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, read_all_states_handler_answers_status_requests)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    switchFeatureHandler.readAllStatesHandler = testReadAllStatesHandler;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    // switch 15 doesn't exist
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 0xAA;
+    expectedCANMessage.data[1] = 0x2A;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadAllStatesHandler(_, 0)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x2AAA, switchFeatureHandler.switchState[0]);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (0 << 4) | 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (0 << 4) | 0;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 0;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadAllStatesHandler(_, 0)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_1_with_zero_stops_polling)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (4 << 8) | (1 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 10;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0010, switchFeatureHandler.pollingMask[0]);
+
+    initiatingCANMessage.data[0] = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.pollingMask[0]);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_featureRouter_millisecondTick(&router, 10));
+}
+
 TEST_F(diypinball_switchFeatureHandler_test, switch_status_polling_edges)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
@@ -784,7 +1128,8 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_swit
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 }
 
 TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_invalid_switch_does_nothing)
@@ -802,7 +1147,8 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_invalid_sw
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0, switchFeatureHandler.switches[15].messageTriggerMask);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openTriggerMask[0]);
 }
 
 TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_switch_with_no_data_does_nothing)
@@ -820,7 +1166,8 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_swit
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 
     initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
     initiatingCANMessage.rtr = 0;
@@ -833,7 +1180,8 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_swit
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 }
 
 TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_switch_only_sets_valid_trigger_mask)
@@ -851,7 +1199,8 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_swit
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 }
 
 TEST_F(diypinball_switchFeatureHandler_test, set_rising_edge_trigger_and_register_switch_status)
@@ -869,7 +1218,8 @@ TEST_F(diypinball_switchFeatureHandler_test, set_rising_edge_trigger_and_registe
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x01, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openTriggerMask[0]);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -929,7 +1279,8 @@ TEST_F(diypinball_switchFeatureHandler_test, set_falling_edge_trigger_and_regist
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x02, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -989,7 +1340,8 @@ TEST_F(diypinball_switchFeatureHandler_test, set_both_edge_trigger_and_register_
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -1048,7 +1400,8 @@ TEST_F(diypinball_switchFeatureHandler_test, set_both_edge_trigger_and_register_
 
 TEST_F(diypinball_switchFeatureHandler_test, set_no_edge_trigger_and_register_switch_status)
 {
-    ASSERT_EQ(0x00, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openTriggerMask[0]);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -1096,7 +1449,8 @@ TEST_F(diypinball_switchFeatureHandler_test, set_both_edge_trigger_and_register_
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -1129,323 +1483,797 @@ TEST_F(diypinball_switchFeatureHandler_test, set_both_edge_trigger_and_register_
     diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 0);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_switch_then_request_gets_trigger_info)
+TEST_F(diypinball_switchFeatureHandler_test, register_switch_states_reports_each_changed_switch_in_order)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+    uint8_t i;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x03;
+    for(i = 0; i < 15; i++) {
+        initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (i << 8) | (2 << 4) | 0;
+        initiatingCANMessage.rtr = 0;
+        initiatingCANMessage.dlc = 1;
+        initiatingCANMessage.data[0] = 0x03;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+        diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    }
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    ASSERT_EQ(0x7FFF, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x7FFF, switchFeatureHandler.openTriggerMask[0]);
 
-    ASSERT_EQ(0x03, switchFeatureHandler.switches[0].messageTriggerMask);
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0011);
+    ASSERT_EQ(0x0011, switchFeatureHandler.switchState[0]);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
+    {
+        InSequence dummy;
 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
-    expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 1;
-    expectedCANMessage.data[0] = 0x03;
-    expectedCANMessage.data[1] = 0;
-    expectedCANMessage.data[2] = 0;
-    expectedCANMessage.data[3] = 0;
-    expectedCANMessage.data[4] = 0;
-    expectedCANMessage.data[5] = 0;
-    expectedCANMessage.data[6] = 0;
-    expectedCANMessage.data[7] = 0;
+        expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (0 << 4) | 0;
+        expectedCANMessage.rtr = 0;
+        expectedCANMessage.dlc = 2;
+        expectedCANMessage.data[0] = 1;
+        expectedCANMessage.data[1] = 1;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+        expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (4 << 8) | (0 << 4) | 0;
+        expectedCANMessage.data[0] = 0;
+        expectedCANMessage.data[1] = 2;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+        expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (14 << 8) | (0 << 4) | 0;
+        expectedCANMessage.data[0] = 1;
+        expectedCANMessage.data[1] = 1;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    }
+
+    // switch 15 is beyond numSwitches and must be ignored
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0xC003);
+
+    ASSERT_EQ(0x4003, switchFeatureHandler.switchState[0]);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_3_to_invalid_switch_does_nothing)
+TEST_F(diypinball_switchFeatureHandler_test, register_switch_states_unchanged_does_nothing)
 {
     diypinball_canMessage_t initiatingCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (3 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0001);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0001);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+
+    ASSERT_EQ(0x0001, switchFeatureHandler.switchState[0]);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_3_to_valid_switch_gives_debouncing_info)
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_8_then_request_gets_delta_report_window)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 5;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(5, switchFeatureHandler.deltaReportWindow);
+
     initiatingCANMessage.rtr = 1;
     initiatingCANMessage.dlc = 0;
 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
     expectedCANMessage.rtr = 0;
     expectedCANMessage.dlc = 1;
-    expectedCANMessage.data[0] = 0; // Switch 0 is initialized to 0 for trigger
-    expectedCANMessage.data[1] = 0;
-    expectedCANMessage.data[2] = 0;
-    expectedCANMessage.data[3] = 0;
-    expectedCANMessage.data[4] = 0;
-    expectedCANMessage.data[5] = 0;
-    expectedCANMessage.data[6] = 0;
-    expectedCANMessage.data[7] = 0;
+    expectedCANMessage.data[0] = 5;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_valid_switch_sets_trigger_mask)
+TEST_F(diypinball_switchFeatureHandler_test, delta_report_coalesces_transitions_within_window)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 120;
-
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(0, 120)).Times(1);
+    initiatingCANMessage.data[0] = 0x03;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(120, switchFeatureHandler.switches[0].debounceLimit);
-}
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (2 << 4) | 0;
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_invalid_switch_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (3 << 4) | 0;
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 120;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.data[0] = 5;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_featureRouter_millisecondTick(&router, 100);
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0001);
+    diypinball_featureRouter_millisecondTick(&router, 102);
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0008);
+    // switch 1 isn't triggered, so it is never reported
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x000A);
+    diypinball_featureRouter_millisecondTick(&router, 104);
 
-    ASSERT_EQ(0, switchFeatureHandler.switches[15].debounceLimit);
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 0x09;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x0A;
+    expectedCANMessage.data[3] = 0x00;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_featureRouter_millisecondTick(&router, 105));
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaMask[0]);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_valid_switch_with_no_data_does_nothing)
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_7_flushes_delta_report)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (2 << 4) | 0;
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 120;
+    initiatingCANMessage.data[0] = 0x01;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(0, 120)).Times(1);
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.data[0] = 200;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(120, switchFeatureHandler.switches[0].debounceLimit);
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
-    initiatingCANMessage.rtr = 0;
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0004);
+
+    initiatingCANMessage.id = (0x02 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
     initiatingCANMessage.dlc = 0;
-    initiatingCANMessage.data[0] = 0;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    expectedCANMessage.id = (0x02 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 0x04;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x04;
+    expectedCANMessage.data[3] = 0x00;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(120, switchFeatureHandler.switches[0].debounceLimit);
+    ASSERT_EQ(0, switchFeatureHandler.pendingDeltaMask[0]);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_valid_switch_then_request_gets_debounce_info)
+TEST_F(diypinball_switchFeatureHandler_test, timestamp_handler_stamps_switch_updates)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (2 << 4) | 0;
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 121;
+    initiatingCANMessage.data[0] = 0x03;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(0, 121)).Times(1);
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    diypinball_switchFeatureHandler_setTimestampHandler(&switchFeatureHandler, testTimestampHandler);
+    testTimestamp = 0x12345678;
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (0 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 6;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
+    expectedCANMessage.data[2] = 0x78;
+    expectedCANMessage.data[3] = 0x56;
+    expectedCANMessage.data[4] = 0x34;
+    expectedCANMessage.data[5] = 0x12;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+
+    ASSERT_EQ(0x12345678, switchFeatureHandler.switches[2].eventTime);
+
+    // back to the plain format
+    diypinball_switchFeatureHandler_setTimestampHandler(&switchFeatureHandler, NULL);
+
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 0;
+    expectedCANMessage.data[1] = 2;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, timestamp_handler_stamps_delta_report_with_first_transition)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(121, switchFeatureHandler.switches[0].debounceLimit);
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (2 << 4) | 0;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.data[0] = 2;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    diypinball_switchFeatureHandler_setTimestampHandler(&switchFeatureHandler, testTimestampHandler);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 0);
+    testTimestamp = 1000;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+    testTimestamp = 1250;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 1);
+
+    ASSERT_EQ(1000, switchFeatureHandler.switches[0].eventTime);
+    ASSERT_EQ(1250, switchFeatureHandler.switches[1].eventTime);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 0x03;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x03;
+    expectedCANMessage.data[3] = 0x00;
+    expectedCANMessage.data[4] = 0xE8;
+    expectedCANMessage.data[5] = 0x03;
+    expectedCANMessage.data[6] = 0x00;
+    expectedCANMessage.data[7] = 0x00;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 2);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, switch_transitions_are_journaled_in_order)
+{
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 3, 1);
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0021);
+    // no change, no entry
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+
+    ASSERT_EQ(4, switchFeatureHandler.journalSequence);
+    ASSERT_EQ(4, switchFeatureHandler.journalCount);
+    ASSERT_EQ(4, switchFeatureHandler.journalHead);
+
+    ASSERT_EQ(1, switchFeatureHandler.journal[0].sequence);
+    ASSERT_EQ(3, switchFeatureHandler.journal[0].switchNum);
+    ASSERT_EQ(1, switchFeatureHandler.journal[0].state);
+
+    ASSERT_EQ(2, switchFeatureHandler.journal[1].sequence);
+    ASSERT_EQ(0, switchFeatureHandler.journal[1].switchNum);
+    ASSERT_EQ(1, switchFeatureHandler.journal[1].state);
+
+    ASSERT_EQ(3, switchFeatureHandler.journal[2].sequence);
+    ASSERT_EQ(3, switchFeatureHandler.journal[2].switchNum);
+    ASSERT_EQ(0, switchFeatureHandler.journal[2].state);
+
+    ASSERT_EQ(4, switchFeatureHandler.journal[3].sequence);
+    ASSERT_EQ(5, switchFeatureHandler.journal[3].switchNum);
+    ASSERT_EQ(1, switchFeatureHandler.journal[3].state);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_10_gives_journal_status)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0003);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (10 << 4) | 0;
     initiatingCANMessage.rtr = 1;
     initiatingCANMessage.dlc = 0;
 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (10 << 4) | 0;
     expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 1;
-    expectedCANMessage.data[0] = 121;
-    expectedCANMessage.data[1] = 0;
-    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.dlc = 3;
+    expectedCANMessage.data[0] = 2;
+    expectedCANMessage.data[1] = 2;
+    expectedCANMessage.data[2] = DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_10_replays_events_after_sequence)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    diypinball_switchFeatureHandler_setTimestampHandler(&switchFeatureHandler, testTimestampHandler);
+
+    testTimestamp = 100;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 1);
+    testTimestamp = 200;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    testTimestamp = 0x01020304;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 0);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (10 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 1;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (10 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 6;
+    expectedCANMessage.data[0] = 2;
+    expectedCANMessage.data[1] = 1;
+    expectedCANMessage.data[2] = 200;
     expectedCANMessage.data[3] = 0;
     expectedCANMessage.data[4] = 0;
     expectedCANMessage.data[5] = 0;
-    expectedCANMessage.data[6] = 0;
-    expectedCANMessage.data[7] = 0;
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
 
+    // one entry per tick
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (10 << 4) | 0;
+    expectedCANMessage.data[0] = 3;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0x04;
+    expectedCANMessage.data[3] = 0x03;
+    expectedCANMessage.data[4] = 0x02;
+    expectedCANMessage.data[5] = 0x01;
     EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
+    diypinball_featureRouter_millisecondTick(&router, 1);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    ASSERT_EQ(0, switchFeatureHandler.replayCount);
+
+    // host already up to date
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    initiatingCANMessage.data[0] = 3;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // no sequence given
+    initiatingCANMessage.dlc = 0;
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_7_through_15_does_nothing)
+TEST_F(diypinball_switchFeatureHandler_test, journal_overflow_replays_only_retained_events)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+    uint8_t i;
+
+    // one more transition than the journal holds, the first is lost
+    for(i = 0; i <= DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE; i++) {
+        diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, (i & 0x01) ? 0 : 1);
+    }
 
-    for(uint8_t i = 7; i < 16; i++) {
-        for(uint8_t j = 0; j < 16; j++) {
-            initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (j << 8) | (i << 4) | 0;
-            initiatingCANMessage.rtr = 1;
-            initiatingCANMessage.dlc = 0;
+    ASSERT_EQ(DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE + 1, switchFeatureHandler.journalSequence);
+    ASSERT_EQ(DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE, switchFeatureHandler.journalCount);
 
-            EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-            EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-            EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (10 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0;
+
+    {
+        InSequence dummy;
 
-            diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+        expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (10 << 4) | 0;
+        expectedCANMessage.rtr = 0;
+        expectedCANMessage.dlc = 2;
+
+        for(i = 2; i <= DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE + 1; i++) {
+            expectedCANMessage.data[0] = i;
+            expectedCANMessage.data[1] = (i & 0x01) ? 1 : 0;
+            EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
         }
     }
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    for(i = 1; i < DIYPINBALL_SWITCHFEATUREHANDLER_JOURNAL_SIZE; i++) {
+        diypinball_featureRouter_millisecondTick(&router, i);
+    }
+
+    ASSERT_EQ(0, switchFeatureHandler.replayCount);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_7_through_15_does_nothing)
+TEST_F(diypinball_switchFeatureHandler_test, journal_replay_waits_for_tx_queue_slots)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    for(uint8_t i = 7; i < 16; i++) {
-        for(uint8_t j = 0; j < 16; j++) {
-            initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (j << 8) | (i << 4) | 0;
-            initiatingCANMessage.rtr = 0;
-            initiatingCANMessage.dlc = 2;
-            initiatingCANMessage.data[0] = 0x42;
-            initiatingCANMessage.data[1] = 0x24;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 0);
 
-            EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-            EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-            EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    diypinball_featureRouter_setTxQueueDepth(&router, 1);
 
-            diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
-        }
-    }
-}
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (10 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0;
 
-TEST(diypinball_switchFeatureHandler_test_other, request_to_function_6_gives_all_switch_statuses)
-{
-    MockCANSend myCANSend;
-    CANSendImpl = &myCANSend;
-    MockSwitchFeatureHandlerHandlers mySwitchFeatureHandlerHandlers;
-    SwitchFeatureHandlerHandlersImpl = &mySwitchFeatureHandlerHandlers;
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
 
-    diypinball_featureRouterInstance_t router;
-    diypinball_featureRouterInit_t routerInit;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_featureRouter_millisecondTick(&router, 1);
 
-    routerInit.boardAddress = 42;
-    routerInit.canSendHandler = testCanSendHandler;
+    // the first entry still holds the only slot
+    ASSERT_EQ(1, router.txQueue.count);
+    ASSERT_EQ(1, switchFeatureHandler.replayCount);
 
-    diypinball_featureRouter_init(&router, &routerInit);
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
 
-    diypinball_switchFeatureHandlerInstance_t switchFeatureHandler;
-    diypinball_switchFeatureHandlerInit_t switchFeatureHandlerInit;
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (10 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
 
-    switchFeatureHandlerInit.numSwitches = 15;
-    switchFeatureHandlerInit.debounceChangedHandler = testDebounceChangedHandler;
-    switchFeatureHandlerInit.readStateHandler = testReadStateHandlerAll;
-    switchFeatureHandlerInit.routerInstance = &router;
+    {
+        InSequence dummy;
 
-    diypinball_switchFeatureHandler_init(&switchFeatureHandler, &switchFeatureHandlerInit);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+        expectedCANMessage.data[0] = 2;
+        expectedCANMessage.data[1] = 0;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    }
+
+    ASSERT_EQ(1, diypinball_featureRouter_transmitNext(&router));
+    diypinball_featureRouter_millisecondTick(&router, 2);
+    ASSERT_EQ(1, diypinball_featureRouter_transmitNext(&router));
+
+    ASSERT_EQ(0, switchFeatureHandler.replayCount);
+}
 
+TEST_F(diypinball_switchFeatureHandler_test, journal_sequence_appended_to_switch_updates)
+{
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (6 << 4) | 0;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 3, 1);
+
+    diypinball_switchFeatureHandler_setJournalSequenceReports(&switchFeatureHandler, 1);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (0 << 4) | 0;
     initiatingCANMessage.rtr = 1;
     initiatingCANMessage.dlc = 0;
 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (0 << 4) | 0;
     expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 2;
-    expectedCANMessage.data[0] = 0xAA; // Even switches are on, odd are off
-    expectedCANMessage.data[1] = 0x2A;
+    expectedCANMessage.dlc = 3;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
+    expectedCANMessage.data[2] = 2; // journaled after switch 3
 
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(1);
     EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(15);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
-}
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_6_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (6 << 4) | 0;
+    // a triggered transition reports its own sequence number after the timestamp
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (2 << 4) | 0;
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x42;
-
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.data[0] = 0x03;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    diypinball_switchFeatureHandler_setTimestampHandler(&switchFeatureHandler, testTimestampHandler);
+    testTimestamp = 0x12345678;
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (0 << 4) | 0;
+    expectedCANMessage.dlc = 7;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
+    expectedCANMessage.data[2] = 0x78;
+    expectedCANMessage.data[3] = 0x56;
+    expectedCANMessage.data[4] = 0x34;
+    expectedCANMessage.data[5] = 0x12;
+    expectedCANMessage.data[6] = 3;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+
+    ASSERT_EQ(3, switchFeatureHandler.journalSequence);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_4_to_invalid_switch_does_nothing)
+TEST_F(diypinball_switchFeatureHandler_test, journal_sequence_appended_to_delta_reports)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (4 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.data[0] = 2;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    diypinball_switchFeatureHandler_setJournalSequenceReports(&switchFeatureHandler, 1);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 0);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 1, 1);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 5;
+    expectedCANMessage.data[0] = 0x01;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x03;
+    expectedCANMessage.data[3] = 0x00;
+    expectedCANMessage.data[4] = 2;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 2);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_4_to_valid_switch_gives_rule_data)
+#if !DIYPINBALL_CAN_FD
+TEST_F(diypinball_switchFeatureHandler_test, journal_sequence_takes_top_timestamp_byte_of_full_classic_frame)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
-    expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 7;
-    expectedCANMessage.data[0] = 0; // Switch 0 is initialized to 0 for trigger
-    expectedCANMessage.data[1] = 0;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.data[0] = 2;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    diypinball_switchFeatureHandler_setTimestampHandler(&switchFeatureHandler, testTimestampHandler);
+    diypinball_switchFeatureHandler_setJournalSequenceReports(&switchFeatureHandler, 1);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 0);
+    testTimestamp = 0x12345678;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 0x01;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x01;
+    expectedCANMessage.data[3] = 0x00;
+    expectedCANMessage.data[4] = 0x78;
+    expectedCANMessage.data[5] = 0x56;
+    expectedCANMessage.data[6] = 0x34;
+    expectedCANMessage.data[7] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 2);
+}
+#endif
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_2_to_valid_switch_then_request_gets_trigger_info)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openTriggerMask[0]);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 1;
+    expectedCANMessage.data[0] = 0x03;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_3_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_3_to_valid_switch_gives_debouncing_info)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 1;
+    expectedCANMessage.data[0] = 0; // Switch 0 is initialized to 0 for trigger
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_valid_switch_sets_trigger_mask)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 120;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(0, 120)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(120, switchFeatureHandler.switches[0].debounceLimit);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 120;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.switches[15].debounceLimit);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_valid_switch_with_no_data_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 120;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(0, 120)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(120, switchFeatureHandler.switches[0].debounceLimit);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.data[0] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(120, switchFeatureHandler.switches[0].debounceLimit);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_3_to_valid_switch_then_request_gets_debounce_info)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 121;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(0, 121)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(121, switchFeatureHandler.switches[0].debounceLimit);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (3 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 1;
+    expectedCANMessage.data[0] = 121;
+    expectedCANMessage.data[1] = 0;
     expectedCANMessage.data[2] = 0;
     expectedCANMessage.data[3] = 0;
     expectedCANMessage.data[4] = 0;
@@ -1453,18 +2281,1406 @@ TEST_F(diypinball_switchFeatureHandler_test, request_to_function_4_to_valid_swit
     expectedCANMessage.data[6] = 0;
     expectedCANMessage.data[7] = 0;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_11_sets_triggering_for_switch_set)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    // switch 15 is beyond numSwitches and must be left alone
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (11 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 0x0F;
+    initiatingCANMessage.data[1] = 0x80;
+    initiatingCANMessage.data[2] = 0x03;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x000F, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x000F, switchFeatureHandler.openTriggerMask[0]);
+
+    initiatingCANMessage.data[0] = 0x05;
+    initiatingCANMessage.data[1] = 0x00;
+    initiatingCANMessage.data[2] = 0x02;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x000A, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x000F, switchFeatureHandler.openTriggerMask[0]);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_11_sets_polling_for_switch_set)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (11 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 0x30;
+    initiatingCANMessage.data[1] = 0x01;
+    initiatingCANMessage.data[2] = 50;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0130, switchFeatureHandler.pollingMask[0]);
+    ASSERT_EQ(1, switchFeatureHandler.pollingBanks);
+    ASSERT_EQ(50, switchFeatureHandler.switches[4].pollingInterval);
+    ASSERT_EQ(50, switchFeatureHandler.switches[5].pollingInterval);
+    ASSERT_EQ(50, switchFeatureHandler.switches[8].pollingInterval);
+    ASSERT_EQ(0, switchFeatureHandler.switches[6].pollingInterval);
+    ASSERT_EQ(50, switchFeatureHandler.nextPollTick);
+
+    initiatingCANMessage.data[2] = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.pollingMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.pollingBanks);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_11_sets_debounce_for_switch_set)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (11 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 0x06;
+    initiatingCANMessage.data[1] = 0x00;
+    initiatingCANMessage.data[2] = 7;
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(1, 7)).Times(1);
+        EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(2, 7)).Times(1);
+    }
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].debounceLimit);
+    ASSERT_EQ(7, switchFeatureHandler.switches[1].debounceLimit);
+    ASSERT_EQ(7, switchFeatureHandler.switches[2].debounceLimit);
+
+    // the bulk handler hears about the whole set at once instead
+    diypinball_switchFeatureHandler_setBulkDebounceChangedHandler(&switchFeatureHandler, testBulkDebounceChangedHandler);
+
+    initiatingCANMessage.data[0] = 0xFF;
+    initiatingCANMessage.data[1] = 0xFF;
+    initiatingCANMessage.data[2] = 3;
+
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testBulkDebounceChangedHandler(0, 0x7FFF, 3)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(3, switchFeatureHandler.switches[14].debounceLimit);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_11_with_bad_data_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    diypinball_switchFeatureHandler_setBulkDebounceChangedHandler(&switchFeatureHandler, testBulkDebounceChangedHandler);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testBulkDebounceChangedHandler(_, _, _)).Times(0);
+
+    // not enough data
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (11 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 2;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 0x00;
+    initiatingCANMessage.data[2] = 5;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // no existing switches in the set
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 0x00;
+    initiatingCANMessage.data[1] = 0x80;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // not a configurable function
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (4 << 8) | (11 << 4) | 0;
+    initiatingCANMessage.data[0] = 0xFF;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // a request
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (11 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].debounceLimit);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].pollingInterval);
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+}
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_STATISTICS
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_12_gives_switch_statistics)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 10);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    diypinball_switchFeatureHandler_registerSwitchBounce(&switchFeatureHandler, 2);
+    diypinball_featureRouter_millisecondTick(&router, 25);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+    diypinball_featureRouter_millisecondTick(&router, 30);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    diypinball_switchFeatureHandler_registerSwitchBounce(&switchFeatureHandler, 2);
+    diypinball_featureRouter_millisecondTick(&router, 50);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+
+    // not a switch
+    diypinball_switchFeatureHandler_registerSwitchBounce(&switchFeatureHandler, 15);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (12 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (12 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 2;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 2;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 15;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 5;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_12_clears_switch_statistics)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    diypinball_featureRouter_millisecondTick(&router, 8);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+    diypinball_switchFeatureHandler_registerSwitchBounce(&switchFeatureHandler, 2);
+
+    ASSERT_EQ(1, switchFeatureHandler.switches[2].statistics.activationCount);
+    ASSERT_EQ(8, switchFeatureHandler.switches[2].statistics.minClosedTime);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (12 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.rtr = 1;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (12 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 0;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0xFF;
+    expectedCANMessage.data[5] = 0xFF;
+    expectedCANMessage.data[6] = 0xFF;
+    expectedCANMessage.data[7] = 0xFF;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // invalid switch
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (12 << 4) | 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+#else
+TEST_F(diypinball_switchFeatureHandler_test, function_12_is_unknown_without_statistics)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (12 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.rtr = 0;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+    diypinball_featureStatistics_t statistics;
+
+    ASSERT_EQ(RESULT_SUCCESS, diypinball_featureRouter_getStatistics(&router, 1, &statistics));
+    ASSERT_EQ(2, statistics.unknownFunctionCount);
+#endif
+}
+#endif
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_13_then_request_gets_fault_limits)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (13 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 4;
+    initiatingCANMessage.data[1] = 50;
+    initiatingCANMessage.data[2] = 20;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(4, switchFeatureHandler.chatterLimit);
+    ASSERT_EQ(50, switchFeatureHandler.chatterWindow);
+    ASSERT_EQ(20, switchFeatureHandler.stuckLimit);
+
+    // not enough data
+    initiatingCANMessage.dlc = 2;
+    initiatingCANMessage.data[0] = 1;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(4, switchFeatureHandler.chatterLimit);
+
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (13 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 3;
+    expectedCANMessage.data[0] = 4;
+    expectedCANMessage.data[1] = 50;
+    expectedCANMessage.data[2] = 20;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, chattering_switch_is_suppressed_until_quiet)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (13 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 3;
+    initiatingCANMessage.data[1] = 50;
+    initiatingCANMessage.data[2] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    switchFeatureHandler.closeTriggerMask[0] = (1 << 2);
+    switchFeatureHandler.openTriggerMask[0] = (1 << 2);
+
+    // the first three edges in the window are reported
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(3);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (13 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = DIYPINBALL_SWITCHFAULT_CHATTER;
+    expectedCANMessage.data[1] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+
+    ASSERT_EQ((1 << 2), switchFeatureHandler.chatterMask[0]);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 20);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    diypinball_featureRouter_millisecondTick(&router, 60);
+
+    ASSERT_EQ((1 << 2), switchFeatureHandler.switchState[0]);
+
+    expectedCANMessage.data[0] = DIYPINBALL_SWITCHFAULT_NONE;
+    expectedCANMessage.data[1] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 70);
+
+    ASSERT_EQ(0, switchFeatureHandler.chatterMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.chatterBanks);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (0 << 4) | 0;
+    expectedCANMessage.data[0] = 0;
+    expectedCANMessage.data[1] = 2;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, disabling_chatter_detection_releases_suppressed_switches)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (13 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 1;
+    initiatingCANMessage.data[1] = 100;
+    initiatingCANMessage.data[2] = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (13 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = DIYPINBALL_SWITCHFAULT_CHATTER;
+    expectedCANMessage.data[1] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 5, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 5, 0);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 5, 1);
+
+    initiatingCANMessage.data[0] = 0;
+
+    expectedCANMessage.data[0] = DIYPINBALL_SWITCHFAULT_NONE;
+    expectedCANMessage.data[1] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.chatterMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.chatterBanks);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, stuck_switch_is_reported_once_and_cleared_on_open)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (13 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 0;
+    initiatingCANMessage.data[1] = 0;
+    initiatingCANMessage.data[2] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    switchFeatureHandler.openTriggerMask[0] = (1 << 2);
+
+    diypinball_featureRouter_millisecondTick(&router, 10);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+    diypinball_featureRouter_millisecondTick(&router, 100);
+
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (13 << 4) | 0;
+    expectedCANMessage1.rtr = 0;
+    expectedCANMessage1.dlc = 2;
+    expectedCANMessage1.data[0] = DIYPINBALL_SWITCHFAULT_STUCK;
+    expectedCANMessage1.data[1] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 110);
+
+    ASSERT_EQ((1 << 2), switchFeatureHandler.stuckMask[0]);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 500);
+
+    expectedCANMessage1.data[0] = 0;
+    expectedCANMessage1.data[1] = 2;
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (0 << 4) | 0;
+
+    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (13 << 4) | 0;
+    expectedCANMessage2.rtr = 0;
+    expectedCANMessage2.dlc = 2;
+    expectedCANMessage2.data[0] = DIYPINBALL_SWITCHFAULT_NONE;
+    expectedCANMessage2.data[1] = 0;
+
+    InSequence dummy;
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 0);
+
+    ASSERT_EQ(0, switchFeatureHandler.stuckMask[0]);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_14_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (14 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_14_with_out_of_range_priority_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    for(uint8_t j = 0; j < 16; j++) {
+        initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (j << 8) | (14 << 4) | 0;
+        initiatingCANMessage.rtr = 0;
+        initiatingCANMessage.dlc = 2;
+        initiatingCANMessage.data[0] = 0x42;
+        initiatingCANMessage.data[1] = 0x24;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+        EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+        EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+        diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+        ASSERT_EQ(DIYPINBALL_SWITCHFEATUREHANDLER_REPORT_PRIORITY, switchFeatureHandler.switches[j].reportPriority);
+    }
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_14_then_request_gets_report_priority)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (14 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 5;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(5, switchFeatureHandler.switches[3].reportPriority);
+
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (14 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 1;
+    expectedCANMessage.data[0] = 5;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, switch_update_uses_report_priority)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (2 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x01;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (14 << 4) | 0;
+    initiatingCANMessage.data[0] = 0x00;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (0 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 2, 1);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, delta_report_uses_most_urgent_report_priority)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (11 << 4) | 0; // trigger on close
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[0] = 0x14;
+    initiatingCANMessage.data[1] = 0x00;
+    initiatingCANMessage.data[2] = 0x01;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (14 << 8) | (11 << 4) | 0; // bulk report priority
+    initiatingCANMessage.data[0] = 0x04;
+    initiatingCANMessage.data[2] = 3;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // out of range, ignored
+    initiatingCANMessage.data[0] = 0x10;
+    initiatingCANMessage.data[2] = 16;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (4 << 8) | (14 << 4) | 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 6;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(3, switchFeatureHandler.switches[2].reportPriority);
+    ASSERT_EQ(6, switchFeatureHandler.switches[4].reportPriority);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0;
+    initiatingCANMessage.data[0] = 20;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0014);
+
+    expectedCANMessage.id = (0x03 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 0x14;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x14;
+    expectedCANMessage.data[3] = 0x00;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 20);
+}
+
+TEST(diypinball_switchFeatureHandler_test_other, request_to_function_6_gives_all_switch_statuses)
+{
+    MockCANSend myCANSend;
+    CANSendImpl = &myCANSend;
+    MockSwitchFeatureHandlerHandlers mySwitchFeatureHandlerHandlers;
+    SwitchFeatureHandlerHandlersImpl = &mySwitchFeatureHandlerHandlers;
+
+    diypinball_featureRouterInstance_t router;
+    diypinball_featureRouterInit_t routerInit;
+
+    routerInit.boardAddress = 42;
+    routerInit.canSendHandler = testCanSendHandler;
+
+    diypinball_featureRouter_init(&router, &routerInit);
+
+    diypinball_switchFeatureHandlerInstance_t switchFeatureHandler;
+    diypinball_switchFeatureHandlerInit_t switchFeatureHandlerInit;
+
+    switchFeatureHandlerInit.numSwitches = 15;
+    switchFeatureHandlerInit.debounceChangedHandler = testDebounceChangedHandler;
+    switchFeatureHandlerInit.readStateHandler = testReadStateHandlerAll;
+    switchFeatureHandlerInit.readAllStatesHandler = NULL;
+    switchFeatureHandlerInit.routerInstance = &router;
+
+    diypinball_switchFeatureHandler_init(&switchFeatureHandler, &switchFeatureHandlerInit);
+
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (6 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 0xAA; // Even switches are on, odd are off
+    expectedCANMessage.data[1] = 0x2A;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(15);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+#if DIYPINBALL_SWITCHFEATUREHANDLER_MAX_SWITCHES >= 48
+TEST(diypinball_switchFeatureHandler_test_other, request_to_function_6_gives_one_page_per_bank)
+{
+    MockCANSend myCANSend;
+    MockSwitchFeatureHandlerHandlers mySwitchFeatureHandlerHandlers;
+    CANSendImpl = &myCANSend;
+    SwitchFeatureHandlerHandlersImpl = &mySwitchFeatureHandlerHandlers;
+
+    diypinball_featureRouterInstance_t router;
+    diypinball_featureRouterInit_t routerInit;
+
+    routerInit.boardAddress = 42;
+    routerInit.canSendHandler = testCanSendHandler;
+
+    diypinball_featureRouter_init(&router, &routerInit);
+
+    diypinball_switchFeatureHandlerInstance_t switchFeatureHandler;
+    diypinball_switchFeatureHandlerInit_t switchFeatureHandlerInit;
+
+    switchFeatureHandlerInit.numSwitches = 40;
+    switchFeatureHandlerInit.debounceChangedHandler = testDebounceChangedHandler;
+    switchFeatureHandlerInit.readStateHandler = testReadStateHandlerAll;
+    switchFeatureHandlerInit.readAllStatesHandler = NULL;
+    switchFeatureHandlerInit.routerInstance = &router;
+
+    diypinball_switchFeatureHandler_init(&switchFeatureHandler, &switchFeatureHandlerInit);
+
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    {
+        InSequence dummy;
+
+        expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 0;
+        expectedCANMessage.rtr = 0;
+        expectedCANMessage.dlc = 2;
+        expectedCANMessage.data[0] = 0xAA;
+        expectedCANMessage.data[1] = 0xAA;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+        expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 1;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+        // only switches 32 to 39 exist in the last bank
+        expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (6 << 4) | 2;
+        expectedCANMessage.data[1] = 0x00;
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    }
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(40);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0xAAAA, switchFeatureHandler.switchState[1]);
+    ASSERT_EQ(0x00AA, switchFeatureHandler.switchState[2]);
+}
+
+TEST(diypinball_switchFeatureHandler_test_other, switches_past_the_first_bank_are_addressed_by_reserved_field)
+{
+    MockCANSend myCANSend;
+    MockSwitchFeatureHandlerHandlers mySwitchFeatureHandlerHandlers;
+    CANSendImpl = &myCANSend;
+    SwitchFeatureHandlerHandlersImpl = &mySwitchFeatureHandlerHandlers;
+
+    diypinball_featureRouterInstance_t router;
+    diypinball_featureRouterInit_t routerInit;
+
+    routerInit.boardAddress = 42;
+    routerInit.canSendHandler = testCanSendHandler;
+
+    diypinball_featureRouter_init(&router, &routerInit);
+
+    diypinball_switchFeatureHandlerInstance_t switchFeatureHandler;
+    diypinball_switchFeatureHandlerInit_t switchFeatureHandlerInit;
+
+    switchFeatureHandlerInit.numSwitches = 40;
+    switchFeatureHandlerInit.debounceChangedHandler = testDebounceChangedHandler;
+    switchFeatureHandlerInit.readStateHandler = testReadStateHandler;
+    switchFeatureHandlerInit.readAllStatesHandler = NULL;
+    switchFeatureHandlerInit.routerInstance = &router;
+
+    diypinball_switchFeatureHandler_init(&switchFeatureHandler, &switchFeatureHandlerInit);
+
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    // switch 37 is switch 5 of bank 2
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (2 << 4) | 2;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x01;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeTriggerMask[0]);
+    ASSERT_EQ(0x0020, switchFeatureHandler.closeTriggerMask[2]);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (5 << 8) | (0 << 4) | 2;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 2;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 1;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 37, 1);
+
+    ASSERT_EQ(0, switchFeatureHandler.switchState[0]);
+    ASSERT_EQ(0x0020, switchFeatureHandler.switchState[2]);
+
+    // switches 40 and up don't exist
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchBankStates(&switchFeatureHandler, 2, 0xFFFF);
+    ASSERT_EQ(0x00FF, switchFeatureHandler.switchState[2]);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 40, 1);
+    ASSERT_EQ(0x00FF, switchFeatureHandler.switchState[2]);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 3;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+#endif
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_6_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (6 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x42;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_4_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_4_to_valid_switch_gives_rule_data)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 7;
+    expectedCANMessage.data[0] = 0; // Switch 0 is initialized to 0 for trigger
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_sets_rule_data)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 7;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(43, switchFeatureHandler.switches[0].openRule.boardAddress);
+    ASSERT_EQ(1, switchFeatureHandler.switches[0].openRule.solenoidNum);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].openRule.attackStatus);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].openRule.attackDuration);
+    ASSERT_EQ(127, switchFeatureHandler.switches[0].openRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.boardAddress);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.solenoidNum);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_with_no_data_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.data[0] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.boardAddress);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.solenoidNum);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_with_not_enough_data_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x01;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.boardAddress);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.solenoidNum);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_with_not_enough_data_for_sustain_only_sets_attack)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 6;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(43, switchFeatureHandler.switches[0].openRule.boardAddress);
+    ASSERT_EQ(1, switchFeatureHandler.switches[0].openRule.solenoidNum);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].openRule.attackStatus);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].openRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_and_request_back)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 7;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0x0001, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(43, switchFeatureHandler.switches[0].openRule.boardAddress);
+    ASSERT_EQ(1, switchFeatureHandler.switches[0].openRule.solenoidNum);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].openRule.attackStatus);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].openRule.attackDuration);
+    ASSERT_EQ(127, switchFeatureHandler.switches[0].openRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+ 
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 7;
+    expectedCANMessage.data[0] = 0x01; // Switch 0 is initialized to 0 for trigger
+    expectedCANMessage.data[1] = 43;
+    expectedCANMessage.data[2] = 1;
+    expectedCANMessage.data[3] = 255;
+    expectedCANMessage.data[4] = 25;
+    expectedCANMessage.data[5] = 127;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_5_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, request_to_function_5_to_valid_switch_gives_rule_data)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 7;
+    expectedCANMessage.data[0] = 0; // Switch 0 is initialized to 0 for trigger
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_sets_rule_data)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 7;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(43, switchFeatureHandler.switches[0].closeRule.boardAddress);
+    ASSERT_EQ(1, switchFeatureHandler.switches[0].closeRule.solenoidNum);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.attackStatus);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.attackDuration);
+    ASSERT_EQ(127, switchFeatureHandler.switches[0].closeRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+
+    ASSERT_EQ((uint32_t) ((0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0), switchFeatureHandler.switches[0].closeRule.frame.id);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.frame.rtr);
+    ASSERT_EQ(4, switchFeatureHandler.switches[0].closeRule.frame.dlc);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.frame.data[0]);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.frame.data[1]);
+    ASSERT_EQ(127, switchFeatureHandler.switches[0].closeRule.frame.data[2]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.frame.data[3]);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_invalid_switch_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x03;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.boardAddress);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.solenoidNum);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_with_no_data_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.data[0] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.boardAddress);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.solenoidNum);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_with_not_enough_data_does_nothing)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x01;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.boardAddress);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.solenoidNum);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_with_not_enough_data_for_sustain_only_sets_attack)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 6;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(43, switchFeatureHandler.switches[0].closeRule.boardAddress);
+    ASSERT_EQ(1, switchFeatureHandler.switches[0].closeRule.solenoidNum);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.attackStatus);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.attackDuration);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_and_request_back)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 7;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x0001, switchFeatureHandler.closeRuleMask[0]);
+    ASSERT_EQ(0, switchFeatureHandler.openRuleMask[0]);
+    ASSERT_EQ(43, switchFeatureHandler.switches[0].closeRule.boardAddress);
+    ASSERT_EQ(1, switchFeatureHandler.switches[0].closeRule.solenoidNum);
+    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.attackStatus);
+    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.attackDuration);
+    ASSERT_EQ(127, switchFeatureHandler.switches[0].closeRule.sustainStatus);
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+ 
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 7;
+    expectedCANMessage.data[0] = 0x01; // Switch 0 is initialized to 0 for trigger
+    expectedCANMessage.data[1] = 43;
+    expectedCANMessage.data[2] = 1;
+    expectedCANMessage.data[3] = 255;
+    expectedCANMessage.data[4] = 25;
+    expectedCANMessage.data[5] = 127;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, test_closed_rule_fires_with_switch_triggering)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // enable close rule
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 7;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0; // enable triggering
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x01;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);    
+ 
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage1.rtr = 0;
+    expectedCANMessage1.dlc = 4;
+    expectedCANMessage1.data[0] = 255;
+    expectedCANMessage1.data[1] = 25;
+    expectedCANMessage1.data[2] = 127;
+    expectedCANMessage1.data[3] = 0;
+
+    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (0 << 4) | 0;
+    expectedCANMessage2.rtr = 0;
+    expectedCANMessage2.dlc = 2;
+    expectedCANMessage2.data[0] = 0x01;
+    expectedCANMessage2.data[1] = 0x01;
+
+    InSequence dummy;
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+}
+
+TEST_F(diypinball_switchFeatureHandler_test, test_closed_rule_fires_once_with_switch_triggering_and_delta_window)
+{
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // enable close rule
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 7;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[2] = 1;
+    initiatingCANMessage.data[3] = 255;
+    initiatingCANMessage.data[4] = 25;
+    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0; // enable triggering
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0x01;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (8 << 4) | 0; // 20ms delta window
+    initiatingCANMessage.data[0] = 20;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage1.rtr = 0;
+    expectedCANMessage1.dlc = 4;
+    expectedCANMessage1.data[0] = 255;
+    expectedCANMessage1.data[1] = 25;
+    expectedCANMessage1.data[2] = 127;
+    expectedCANMessage1.data[3] = 0;
+
+    // the coil fires at the edge, as it does without a window
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage2.rtr = 0;
+    expectedCANMessage2.dlc = 4;
+    expectedCANMessage2.data[0] = 0x01;
+    expectedCANMessage2.data[1] = 0x00;
+    expectedCANMessage2.data[2] = 0x01;
+    expectedCANMessage2.data[3] = 0x00;
+
+    // the delayed report doesn't fire it a second time
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(0);
+
+    diypinball_featureRouter_millisecondTick(&router, 20);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_sets_rule_data)
+TEST_F(diypinball_switchFeatureHandler_test, test_open_rule_fires_with_switch_triggering)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0; // enable open rule
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 7;
     initiatingCANMessage.data[0] = 0x01;
@@ -1481,23 +3697,10 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_swit
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x01, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(43, switchFeatureHandler.switches[0].openRule.boardAddress);
-    ASSERT_EQ(1, switchFeatureHandler.switches[0].openRule.solenoidNum);
-    ASSERT_EQ(255, switchFeatureHandler.switches[0].openRule.attackStatus);
-    ASSERT_EQ(25, switchFeatureHandler.switches[0].openRule.attackDuration);
-    ASSERT_EQ(127, switchFeatureHandler.switches[0].openRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
-}
-
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_invalid_switch_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
-
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0; // enable triggering
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x03;
+    initiatingCANMessage.data[0] = 0x02;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -1505,77 +3708,49 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_invalid_sw
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.boardAddress);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.solenoidNum);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
-}
-
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_with_no_data_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
-
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 0;
-    initiatingCANMessage.data[0] = 0;
-
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
-
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.boardAddress);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.solenoidNum);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
-}
-
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_with_not_enough_data_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+ 
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage1.rtr = 0;
+    expectedCANMessage1.dlc = 4;
+    expectedCANMessage1.data[0] = 255;
+    expectedCANMessage1.data[1] = 25;
+    expectedCANMessage1.data[2] = 127;
+    expectedCANMessage1.data[3] = 0;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x01;
+    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (0 << 4) | 0;
+    expectedCANMessage2.rtr = 0;
+    expectedCANMessage2.dlc = 2;
+    expectedCANMessage2.data[0] = 0x00;
+    expectedCANMessage2.data[1] = 0x02;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    InSequence dummy;
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
-
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.boardAddress);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.solenoidNum);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_with_not_enough_data_for_sustain_only_sets_attack)
+TEST_F(diypinball_switchFeatureHandler_test, test_closed_rule_fires_without_switch_triggering)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // enable close rule
     initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 6;
-    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.dlc = 7;
     initiatingCANMessage.data[0] = 0x01;
     initiatingCANMessage.data[1] = 43;
     initiatingCANMessage.data[2] = 1;
     initiatingCANMessage.data[3] = 255;
     initiatingCANMessage.data[4] = 25;
     initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[6] = 0;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
     EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
@@ -1583,359 +3758,391 @@ TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_swit
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x01, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(43, switchFeatureHandler.switches[0].openRule.boardAddress);
-    ASSERT_EQ(1, switchFeatureHandler.switches[0].openRule.solenoidNum);
-    ASSERT_EQ(255, switchFeatureHandler.switches[0].openRule.attackStatus);
-    ASSERT_EQ(25, switchFeatureHandler.switches[0].openRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);    
+ 
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage1.rtr = 0;
+    expectedCANMessage1.dlc = 4;
+    expectedCANMessage1.data[0] = 255;
+    expectedCANMessage1.data[1] = 25;
+    expectedCANMessage1.data[2] = 127;
+    expectedCANMessage1.data[3] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_4_to_valid_switch_and_request_back)
+TEST_F(diypinball_switchFeatureHandler_test, test_local_rule_goes_to_coil_envelope_generator)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+    diypinball_coilEnvelopeGeneratorInstance_t coilEnvelopeGenerator;
+    diypinball_coilEnvelopeGeneratorInit_t coilEnvelopeGeneratorInit;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
+    coilEnvelopeGeneratorInit.numCoils = 4;
+    coilEnvelopeGeneratorInit.coilStateHandler = testCoilStateHandler;
+    diypinball_coilEnvelopeGenerator_init(&coilEnvelopeGenerator, &coilEnvelopeGeneratorInit);
+
+    diypinball_switchFeatureHandler_setLocalCoils(&switchFeatureHandler, &coilEnvelopeGenerator, 0);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // close rule for this board
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 7;
     initiatingCANMessage.data[0] = 0x01;
-    initiatingCANMessage.data[1] = 43;
+    initiatingCANMessage.data[1] = 42;
     initiatingCANMessage.data[2] = 1;
     initiatingCANMessage.data[3] = 255;
     initiatingCANMessage.data[4] = 25;
     initiatingCANMessage.data[5] = 127;
     initiatingCANMessage.data[6] = 0;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
-
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x01, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(43, switchFeatureHandler.switches[0].openRule.boardAddress);
-    ASSERT_EQ(1, switchFeatureHandler.switches[0].openRule.solenoidNum);
-    ASSERT_EQ(255, switchFeatureHandler.switches[0].openRule.attackStatus);
-    ASSERT_EQ(25, switchFeatureHandler.switches[0].openRule.attackDuration);
-    ASSERT_EQ(127, switchFeatureHandler.switches[0].openRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].openRule.sustainDuration);
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0; // open rule for another board
+    initiatingCANMessage.data[1] = 43;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
- 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0;
-    expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 7;
-    expectedCANMessage.data[0] = 0x01; // Switch 0 is initialized to 0 for trigger
-    expectedCANMessage.data[1] = 43;
-    expectedCANMessage.data[2] = 1;
-    expectedCANMessage.data[3] = 255;
-    expectedCANMessage.data[4] = 25;
-    expectedCANMessage.data[5] = 127;
-    expectedCANMessage.data[6] = 0;
-    expectedCANMessage.data[7] = 0;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testCoilStateHandler(1, 255)).Times(1);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
-}
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_5_to_invalid_switch_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
+    ASSERT_EQ(1, coilEnvelopeGenerator.lastPhases[1]);
+    ASSERT_EQ(25, coilEnvelopeGenerator.coils[1].attackDuration);
+    ASSERT_EQ(127, coilEnvelopeGenerator.coils[1].sustainState);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (5 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 255;
+    expectedCANMessage.data[1] = 25;
+    expectedCANMessage.data[2] = 127;
+    expectedCANMessage.data[3] = 0;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testCoilStateHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, request_to_function_5_to_valid_switch_gives_rule_data)
+TEST_F(diypinball_switchFeatureHandler_test, test_local_rule_can_be_announced)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+    diypinball_coilEnvelopeGeneratorInstance_t coilEnvelopeGenerator;
+    diypinball_coilEnvelopeGeneratorInit_t coilEnvelopeGeneratorInit;
+
+    coilEnvelopeGeneratorInit.numCoils = 4;
+    coilEnvelopeGeneratorInit.coilStateHandler = testCoilStateHandler;
+    diypinball_coilEnvelopeGenerator_init(&coilEnvelopeGenerator, &coilEnvelopeGeneratorInit);
+
+    diypinball_switchFeatureHandler_setLocalCoils(&switchFeatureHandler, &coilEnvelopeGenerator, 1);
 
     initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 5;
+    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.data[1] = 42;
+    initiatingCANMessage.data[2] = 2;
+    initiatingCANMessage.data[3] = 200;
+    initiatingCANMessage.data[4] = 10;
 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (3 << 12) | (2 << 8) | (0 << 4) | 0;
     expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 7;
-    expectedCANMessage.data[0] = 0; // Switch 0 is initialized to 0 for trigger
-    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 200;
+    expectedCANMessage.data[1] = 10;
     expectedCANMessage.data[2] = 0;
     expectedCANMessage.data[3] = 0;
-    expectedCANMessage.data[4] = 0;
-    expectedCANMessage.data[5] = 0;
-    expectedCANMessage.data[6] = 0;
-    expectedCANMessage.data[7] = 0;
 
+    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testCoilStateHandler(2, 200)).Times(1);
     EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_sets_rule_data)
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_9_then_request_gets_action)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (9 << 4) | 0;
     initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 7;
-    initiatingCANMessage.data[0] = 0x01;
-    initiatingCANMessage.data[1] = 43;
-    initiatingCANMessage.data[2] = 1;
-    initiatingCANMessage.data[3] = 255;
-    initiatingCANMessage.data[4] = 25;
-    initiatingCANMessage.data[5] = 127;
-    initiatingCANMessage.data[6] = 0;
+    initiatingCANMessage.dlc = 8;
+    initiatingCANMessage.data[0] = (0x01 << 4) | 4;
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_COIL << 4) | 2;
+    initiatingCANMessage.data[2] = DIYPINBALL_SWITCHACTION_GUARD_ENABLE | DIYPINBALL_SWITCHACTION_GUARD_CLOSED | 5;
+    initiatingCANMessage.data[3] = 43;
+    initiatingCANMessage.data[4] = 255;
+    initiatingCANMessage.data[5] = 3;
+    initiatingCANMessage.data[6] = 64;
+    initiatingCANMessage.data[7] = 0;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x02, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(43, switchFeatureHandler.switches[0].closeRule.boardAddress);
-    ASSERT_EQ(1, switchFeatureHandler.switches[0].closeRule.solenoidNum);
-    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.attackStatus);
-    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.attackDuration);
-    ASSERT_EQ(127, switchFeatureHandler.switches[0].closeRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
-}
-
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_invalid_switch_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
-
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (5 << 4) | 0;
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x03;
+    ASSERT_EQ(4, switchFeatureHandler.actions[3].switchNum);
+    ASSERT_EQ(0x01, switchFeatureHandler.actions[3].eventMask);
+    ASSERT_EQ(DIYPINBALL_SWITCHACTION_COIL, switchFeatureHandler.actions[3].type);
+    ASSERT_EQ(2, switchFeatureHandler.actions[3].targetNum);
+    ASSERT_EQ(0x0010, switchFeatureHandler.actionSwitchMask[0]);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (9 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = (0x01 << 4) | 4;
+    expectedCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_COIL << 4) | 2;
+    expectedCANMessage.data[2] = DIYPINBALL_SWITCHACTION_GUARD_ENABLE | DIYPINBALL_SWITCHACTION_GUARD_CLOSED | 5;
+    expectedCANMessage.data[3] = 43;
+    expectedCANMessage.data[4] = 255;
+    expectedCANMessage.data[5] = 3;
+    expectedCANMessage.data[6] = 64;
+    expectedCANMessage.data[7] = 0;
 
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.boardAddress);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.solenoidNum);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
-}
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_with_no_data_does_nothing)
-{
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    // clearing the entry removes the switch from the action mask
     initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 0;
-    initiatingCANMessage.data[0] = 0;
+    initiatingCANMessage.dlc = 2;
+    initiatingCANMessage.data[1] = 0;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.boardAddress);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.solenoidNum);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+    ASSERT_EQ(DIYPINBALL_SWITCHACTION_NONE, switchFeatureHandler.actions[3].type);
+    ASSERT_EQ(0, switchFeatureHandler.actionSwitchMask[0]);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_with_not_enough_data_does_nothing)
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_9_with_invalid_entry_does_nothing)
 {
     diypinball_canMessage_t initiatingCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (DIYPINBALL_SWITCHFEATUREHANDLER_ACTION_COUNT << 8) | (9 << 4) | 0;
     initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x01;
+    initiatingCANMessage.dlc = 8;
+    initiatingCANMessage.data[0] = (0x01 << 4) | 4;
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_LAMP << 4) | 2;
+    initiatingCANMessage.data[2] = 0;
+    initiatingCANMessage.data[3] = 43;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // switch 15 doesn't exist
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (9 << 4) | 0;
+    initiatingCANMessage.data[0] = (0x01 << 4) | 15;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.boardAddress);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.solenoidNum);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+    // unknown action type
+    initiatingCANMessage.data[0] = (0x01 << 4) | 4;
+    initiatingCANMessage.data[1] = (0x0F << 4) | 2;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // guard switch 15 doesn't exist
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_LAMP << 4) | 2;
+    initiatingCANMessage.data[2] = DIYPINBALL_SWITCHACTION_GUARD_ENABLE | 15;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    // guard can't name a switch in another bank
+    initiatingCANMessage.data[2] = DIYPINBALL_SWITCHACTION_GUARD_ENABLE | 0x10 | 5;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, switchFeatureHandler.actionSwitchMask[0]);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_with_not_enough_data_for_sustain_only_sets_attack)
+TEST_F(diypinball_switchFeatureHandler_test, switch_actions_run_in_table_order)
 {
-    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2, expectedCANMessage3;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    // slingshot: pulse coil 1 and flash lamp 6 on close, tell the host on open
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (9 << 4) | 0;
     initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 8;
+    initiatingCANMessage.data[0] = (0x01 << 4) | 3;
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_COIL << 4) | 1;
+    initiatingCANMessage.data[2] = 0;
+    initiatingCANMessage.data[3] = 43;
+    initiatingCANMessage.data[4] = 255;
+    initiatingCANMessage.data[5] = 2;
+    initiatingCANMessage.data[6] = 0;
+    initiatingCANMessage.data[7] = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (1 << 8) | (9 << 4) | 0;
     initiatingCANMessage.dlc = 6;
-    initiatingCANMessage.data[0] = 0x01;
-    initiatingCANMessage.data[0] = 0x01;
-    initiatingCANMessage.data[1] = 43;
-    initiatingCANMessage.data[2] = 1;
-    initiatingCANMessage.data[3] = 255;
-    initiatingCANMessage.data[4] = 25;
-    initiatingCANMessage.data[5] = 127;
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_LAMP << 4) | 6;
+    initiatingCANMessage.data[3] = 44;
+    initiatingCANMessage.data[4] = 255;
+    initiatingCANMessage.data[5] = 10;
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (9 << 4) | 0;
+    initiatingCANMessage.dlc = 8;
+    initiatingCANMessage.data[0] = (0x02 << 4) | 3;
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_HOST << 4);
+    initiatingCANMessage.data[3] = 0;
+    initiatingCANMessage.data[4] = 0xDE;
+    initiatingCANMessage.data[5] = 0xAD;
+    initiatingCANMessage.data[6] = 0xBE;
+    initiatingCANMessage.data[7] = 0xEF;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x02, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(43, switchFeatureHandler.switches[0].closeRule.boardAddress);
-    ASSERT_EQ(1, switchFeatureHandler.switches[0].closeRule.solenoidNum);
-    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.attackStatus);
-    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.attackDuration);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
+    ASSERT_EQ(0x0008, switchFeatureHandler.actionSwitchMask[0]);
+
+    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage1.rtr = 0;
+    expectedCANMessage1.dlc = 4;
+    expectedCANMessage1.data[0] = 255;
+    expectedCANMessage1.data[1] = 2;
+    expectedCANMessage1.data[2] = 0;
+    expectedCANMessage1.data[3] = 0;
+
+    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (44 << 16) | (2 << 12) | (6 << 8) | (0 << 4) | 0;
+    expectedCANMessage2.rtr = 0;
+    expectedCANMessage2.dlc = 4;
+    expectedCANMessage2.data[0] = 255;
+    expectedCANMessage2.data[1] = 10;
+    expectedCANMessage2.data[2] = 0;
+    expectedCANMessage2.data[3] = 0;
+
+    expectedCANMessage3.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (2 << 8) | (9 << 4) | 0;
+    expectedCANMessage3.rtr = 0;
+    expectedCANMessage3.dlc = 4;
+    expectedCANMessage3.data[0] = 0xDE;
+    expectedCANMessage3.data[1] = 0xAD;
+    expectedCANMessage3.data[2] = 0xBE;
+    expectedCANMessage3.data[3] = 0xEF;
+
+    {
+        InSequence dummy;
+
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
+        EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage3))).Times(1);
+    }
+
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 3, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 3, 0);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, message_to_function_5_to_valid_switch_and_request_back)
+TEST_F(diypinball_switchFeatureHandler_test, switch_action_guard_checks_other_switch)
 {
     diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    // flipper hold only while EOS switch 5 is open
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (9 << 4) | 0;
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 7;
-    initiatingCANMessage.data[0] = 0x01;
-    initiatingCANMessage.data[1] = 43;
-    initiatingCANMessage.data[2] = 1;
-    initiatingCANMessage.data[3] = 255;
-    initiatingCANMessage.data[4] = 25;
-    initiatingCANMessage.data[5] = 127;
-    initiatingCANMessage.data[6] = 0;
-
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.data[0] = (0x01 << 4) | 4;
+    initiatingCANMessage.data[1] = (DIYPINBALL_SWITCHACTION_RGB << 4) | 0;
+    initiatingCANMessage.data[2] = DIYPINBALL_SWITCHACTION_GUARD_ENABLE | 5;
+    initiatingCANMessage.data[3] = 43;
+    initiatingCANMessage.data[4] = 1;
+    initiatingCANMessage.data[5] = 2;
+    initiatingCANMessage.data[6] = 3;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    ASSERT_EQ(0x02, switchFeatureHandler.switches[0].ruleMask);
-    ASSERT_EQ(43, switchFeatureHandler.switches[0].closeRule.boardAddress);
-    ASSERT_EQ(1, switchFeatureHandler.switches[0].closeRule.solenoidNum);
-    ASSERT_EQ(255, switchFeatureHandler.switches[0].closeRule.attackStatus);
-    ASSERT_EQ(25, switchFeatureHandler.switches[0].closeRule.attackDuration);
-    ASSERT_EQ(127, switchFeatureHandler.switches[0].closeRule.sustainStatus);
-    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.sustainDuration);
-
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
-    initiatingCANMessage.rtr = 1;
-    initiatingCANMessage.dlc = 0;
- 
-    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0;
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (5 << 12) | (0 << 8) | (0 << 4) | 0;
     expectedCANMessage.rtr = 0;
-    expectedCANMessage.dlc = 7;
-    expectedCANMessage.data[0] = 0x01; // Switch 0 is initialized to 0 for trigger
-    expectedCANMessage.data[1] = 43;
-    expectedCANMessage.data[2] = 1;
-    expectedCANMessage.data[3] = 255;
-    expectedCANMessage.data[4] = 25;
-    expectedCANMessage.data[5] = 127;
-    expectedCANMessage.data[6] = 0;
-    expectedCANMessage.data[7] = 0;
+    expectedCANMessage.dlc = 3;
+    expectedCANMessage.data[0] = 1;
+    expectedCANMessage.data[1] = 2;
+    expectedCANMessage.data[2] = 3;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
-    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0010);
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0000);
+    // switch 5 closing in the same batch blocks the action
+    diypinball_switchFeatureHandler_registerSwitchStates(&switchFeatureHandler, 0x0030);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, test_closed_rule_fires_with_switch_triggering)
+TEST_F(diypinball_switchFeatureHandler_test, message_to_function_15_then_request_gets_rule_cooldowns)
 {
-    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // enable close rule
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (15 << 4) | 0;
     initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 7;
-    initiatingCANMessage.data[0] = 0x01;
-    initiatingCANMessage.data[1] = 43;
-    initiatingCANMessage.data[2] = 1;
-    initiatingCANMessage.data[3] = 255;
-    initiatingCANMessage.data[4] = 25;
-    initiatingCANMessage.data[5] = 127;
-    initiatingCANMessage.data[6] = 0;
+    initiatingCANMessage.dlc = 4;
+    initiatingCANMessage.data[0] = 0x2C;
+    initiatingCANMessage.data[1] = 0x01;
+    initiatingCANMessage.data[2] = 50;
+    initiatingCANMessage.data[3] = 0;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0; // enable triggering
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x01;
+    ASSERT_EQ(300, switchFeatureHandler.switches[3].closeRule.cooldown);
+    ASSERT_EQ(50, switchFeatureHandler.switches[3].openRule.cooldown);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    // not enough data
+    initiatingCANMessage.dlc = 3;
+    initiatingCANMessage.data[2] = 70;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    ASSERT_EQ(50, switchFeatureHandler.switches[3].openRule.cooldown);
 
-    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);    
- 
-    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
-    expectedCANMessage1.rtr = 0;
-    expectedCANMessage1.dlc = 4;
-    expectedCANMessage1.data[0] = 255;
-    expectedCANMessage1.data[1] = 25;
-    expectedCANMessage1.data[2] = 127;
-    expectedCANMessage1.data[3] = 0;
+    // not a switch
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (15 << 8) | (15 << 4) | 0;
+    initiatingCANMessage.dlc = 4;
 
-    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (0 << 4) | 0;
-    expectedCANMessage2.rtr = 0;
-    expectedCANMessage2.dlc = 2;
-    expectedCANMessage2.data[0] = 0x01;
-    expectedCANMessage2.data[1] = 0x01;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    InSequence dummy;
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
 
-    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (15 << 4) | 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (3 << 8) | (15 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 0x2C;
+    expectedCANMessage.data[1] = 0x01;
+    expectedCANMessage.data[2] = 50;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 0;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, test_open_rule_fires_with_switch_triggering)
+TEST_F(diypinball_switchFeatureHandler_test, rule_cooldown_suppresses_refiring)
 {
-    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1, expectedCANMessage2;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
 
-    initiatingCANMessage.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (4 << 4) | 0; // enable open rule
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // enable close rule
     initiatingCANMessage.rtr = 0;
     initiatingCANMessage.dlc = 7;
     initiatingCANMessage.data[0] = 0x01;
@@ -1947,54 +4154,57 @@ TEST_F(diypinball_switchFeatureHandler_test, test_open_rule_fires_with_switch_tr
     initiatingCANMessage.data[6] = 0;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (2 << 4) | 0; // enable triggering
-    initiatingCANMessage.rtr = 0;
-    initiatingCANMessage.dlc = 1;
-    initiatingCANMessage.data[0] = 0x02;
-
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (15 << 4) | 0; // 100ms close cooldown
+    initiatingCANMessage.dlc = 4;
+    initiatingCANMessage.data[0] = 100;
+    initiatingCANMessage.data[1] = 0;
+    initiatingCANMessage.data[2] = 0;
+    initiatingCANMessage.data[3] = 0;
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 255;
+    expectedCANMessage.data[1] = 25;
+    expectedCANMessage.data[2] = 127;
+    expectedCANMessage.data[3] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_millisecondTick(&router, 10);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
+
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
+    diypinball_featureRouter_millisecondTick(&router, 60);
     diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
- 
-    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
-    expectedCANMessage1.rtr = 0;
-    expectedCANMessage1.dlc = 4;
-    expectedCANMessage1.data[0] = 255;
-    expectedCANMessage1.data[1] = 25;
-    expectedCANMessage1.data[2] = 127;
-    expectedCANMessage1.data[3] = 0;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
+    diypinball_featureRouter_millisecondTick(&router, 109);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
 
-    expectedCANMessage2.id = (0x01 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (0 << 4) | 0;
-    expectedCANMessage2.rtr = 0;
-    expectedCANMessage2.dlc = 2;
-    expectedCANMessage2.data[0] = 0x00;
-    expectedCANMessage2.data[1] = 0x02;
+    ASSERT_EQ(2, switchFeatureHandler.switches[0].closeRule.suppressedCount);
 
-    InSequence dummy;
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage2))).Times(1);
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
 
-    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
+    diypinball_featureRouter_millisecondTick(&router, 110);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+
+    ASSERT_EQ(2, switchFeatureHandler.switches[0].closeRule.suppressedCount);
 }
 
-TEST_F(diypinball_switchFeatureHandler_test, test_closed_rule_fires_without_switch_triggering)
+TEST_F(diypinball_switchFeatureHandler_test, rule_cooldown_uses_tick_source_between_ticks)
 {
-    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage1;
+    diypinball_canMessage_t initiatingCANMessage, expectedCANMessage;
+
+    testTickSource = 100;
+    diypinball_featureRouter_setTickSourceHandler(&router, testTickSourceHandler);
 
     initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (5 << 4) | 0; // enable close rule
     initiatingCANMessage.rtr = 0;
@@ -2008,30 +4218,38 @@ TEST_F(diypinball_switchFeatureHandler_test, test_closed_rule_fires_without_swit
     initiatingCANMessage.data[6] = 0;
 
     EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
 
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (1 << 12) | (0 << 8) | (15 << 4) | 0; // 100ms close cooldown
+    initiatingCANMessage.dlc = 4;
+    initiatingCANMessage.data[0] = 100;
+    initiatingCANMessage.data[1] = 0;
+    initiatingCANMessage.data[2] = 0;
+    initiatingCANMessage.data[3] = 0;
 
-    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);    
- 
-    expectedCANMessage1.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
-    expectedCANMessage1.rtr = 0;
-    expectedCANMessage1.dlc = 4;
-    expectedCANMessage1.data[0] = 255;
-    expectedCANMessage1.data[1] = 25;
-    expectedCANMessage1.data[2] = 127;
-    expectedCANMessage1.data[3] = 0;
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 
-    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage1))).Times(1);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testReadStateHandler(_, _)).Times(0);
-    EXPECT_CALL(mySwitchFeatureHandlerHandlers, testDebounceChangedHandler(_, _)).Times(0);
+    expectedCANMessage.id = (0x01 << 25) | (1 << 24) | (43 << 16) | (3 << 12) | (1 << 8) | (0 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 255;
+    expectedCANMessage.data[1] = 25;
+    expectedCANMessage.data[2] = 127;
+    expectedCANMessage.data[3] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(2);
 
+    diypinball_featureRouter_millisecondTick(&router, 100);
     diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 0);
+
+    // the main loop slept through the gap, no tick was passed in since 100
+    testTickSource = 1000;
+    diypinball_switchFeatureHandler_registerSwitchState(&switchFeatureHandler, 0, 1);
+
+    ASSERT_EQ(0, switchFeatureHandler.switches[0].closeRule.suppressedCount);
+    ASSERT_EQ(1000, switchFeatureHandler.switches[0].closeRule.lastFireTick);
 }
 
 TEST_F(diypinball_switchFeatureHandler_test, test_open_rule_fires_without_switch_triggering)
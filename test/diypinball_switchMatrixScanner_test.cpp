@@ -11,11 +11,13 @@ using ::testing::Return;
 using ::testing::_;
 using ::testing::InSequence;
 using ::testing::SetArgPointee;
+using ::testing::AnyNumber;
 
 class MockSwitchMatrixScannerHandlers {
 public:
     virtual ~MockSwitchMatrixScannerHandlers() {}
     MOCK_METHOD2(testSwitchStateHandler, void(uint8_t, uint8_t));
+    MOCK_METHOD1(testSwitchBounceHandler, void(uint8_t));
     MOCK_METHOD1(testSetColumnHandler, void(int8_t));
     MOCK_METHOD1(testReadRowHandler, void(uint8_t*));
 };
@@ -27,6 +29,10 @@ extern "C" {
         SwitchMatrixScannerHandlersImpl->testSwitchStateHandler(switchNum, state);
     }
 
+    static void testSwitchBounceHandler(uint8_t switchNum) {
+        SwitchMatrixScannerHandlersImpl->testSwitchBounceHandler(switchNum);
+    }
+
     static void testSetColumnHandler(int8_t colNum) {
         SwitchMatrixScannerHandlersImpl->testSetColumnHandler(colNum);
     }
@@ -46,6 +52,7 @@ class diypinball_switchMatrixScanner_test : public testing::Test {
 
         switchMatrixScannerInit.numColumns = 4;
         switchMatrixScannerInit.switchStateHandler = testSwitchStateHandler;
+        switchMatrixScannerInit.switchBounceHandler = testSwitchBounceHandler;
         switchMatrixScannerInit.setColumnHandler = testSetColumnHandler;
         switchMatrixScannerInit.readRowHandler = testReadRowHandler;
 
@@ -62,9 +69,11 @@ TEST_F(diypinball_switchMatrixScanner_test, init_zeros_structure)
         ASSERT_EQ(0, switchMatrixScanner.switches[i].switchState);
         ASSERT_EQ(0, switchMatrixScanner.switches[i].lastTick);
         ASSERT_EQ(0, switchMatrixScanner.switches[i].debounceLimit);
+        ASSERT_EQ(0, switchMatrixScanner.switches[i].rawState);
     }
 
     ASSERT_TRUE(testSwitchStateHandler == switchMatrixScanner.switchStateHandler);
+    ASSERT_TRUE(testSwitchBounceHandler == switchMatrixScanner.switchBounceHandler);
     ASSERT_TRUE(testSetColumnHandler == switchMatrixScanner.setColumnHandler);
     ASSERT_TRUE(testReadRowHandler == switchMatrixScanner.readRowHandler);
     ASSERT_EQ(4, switchMatrixScanner.numColumns);
@@ -80,9 +89,11 @@ TEST_F(diypinball_switchMatrixScanner_test, deinit_zeros_structure)
         ASSERT_EQ(0, switchMatrixScanner.switches[i].switchState);
         ASSERT_EQ(0, switchMatrixScanner.switches[i].lastTick);
         ASSERT_EQ(0, switchMatrixScanner.switches[i].debounceLimit);
+        ASSERT_EQ(0, switchMatrixScanner.switches[i].rawState);
     }
 
     ASSERT_TRUE(NULL == switchMatrixScanner.switchStateHandler);
+    ASSERT_TRUE(NULL == switchMatrixScanner.switchBounceHandler);
     ASSERT_TRUE(NULL == switchMatrixScanner.setColumnHandler);
     ASSERT_TRUE(NULL == switchMatrixScanner.readRowHandler);
     ASSERT_EQ(0, switchMatrixScanner.numColumns);
@@ -100,6 +111,7 @@ TEST(diypinball_switchMatrixScanner_test_other, init_too_many_columns)
 
     switchMatrixScannerInit.numColumns = 5;
     switchMatrixScannerInit.switchStateHandler = testSwitchStateHandler;
+    switchMatrixScannerInit.switchBounceHandler = NULL;
     switchMatrixScannerInit.setColumnHandler = testSetColumnHandler;
     switchMatrixScannerInit.readRowHandler = testReadRowHandler;
 
@@ -109,9 +121,11 @@ TEST(diypinball_switchMatrixScanner_test_other, init_too_many_columns)
         ASSERT_EQ(0, switchMatrixScanner.switches[i].switchState);
         ASSERT_EQ(0, switchMatrixScanner.switches[i].lastTick);
         ASSERT_EQ(0, switchMatrixScanner.switches[i].debounceLimit);
+        ASSERT_EQ(0, switchMatrixScanner.switches[i].rawState);
     }
 
     ASSERT_TRUE(testSwitchStateHandler == switchMatrixScanner.switchStateHandler);
+    ASSERT_TRUE(NULL == switchMatrixScanner.switchBounceHandler);
     ASSERT_TRUE(testSetColumnHandler == switchMatrixScanner.setColumnHandler);
     ASSERT_TRUE(testReadRowHandler == switchMatrixScanner.readRowHandler);
     ASSERT_EQ(4, switchMatrixScanner.numColumns);
@@ -139,6 +153,7 @@ TEST_F(diypinball_switchMatrixScanner_test, set_debounce_limit_invalid)
 
     for(uint8_t i = 0; i < 16; i++) {
         ASSERT_EQ(0, switchMatrixScanner.switches[i].debounceLimit);
+        ASSERT_EQ(0, switchMatrixScanner.switches[i].rawState);
     }
 }
 
@@ -177,6 +192,7 @@ TEST(diypinball_switchMatrixScanner_test_other, isr_flow_few_columns) {
 
     switchMatrixScannerInit.numColumns = 3;
     switchMatrixScannerInit.switchStateHandler = testSwitchStateHandler;
+    switchMatrixScannerInit.switchBounceHandler = NULL;
     switchMatrixScannerInit.setColumnHandler = testSetColumnHandler;
     switchMatrixScannerInit.readRowHandler = testReadRowHandler;
 
@@ -621,3 +637,38 @@ TEST_F(diypinball_switchMatrixScanner_test, read_switch_state) {
     result = diypinball_switchMatrixScanner_readSwitchState(&switchMatrixScanner, 17);
     ASSERT_EQ(0, result);
 }
+
+TEST_F(diypinball_switchMatrixScanner_test, switch_bounces_reported) {
+    diypinball_switchMatrixScanner_deinit(&switchMatrixScanner);
+
+    diypinball_switchMatrixScannerInit_t switchMatrixScannerInit;
+
+    switchMatrixScannerInit.numColumns = 1;
+    switchMatrixScannerInit.switchStateHandler = testSwitchStateHandler;
+    switchMatrixScannerInit.switchBounceHandler = testSwitchBounceHandler;
+    switchMatrixScannerInit.setColumnHandler = testSetColumnHandler;
+    switchMatrixScannerInit.readRowHandler = testReadRowHandler;
+
+    diypinball_switchMatrixScanner_init(&switchMatrixScanner, &switchMatrixScannerInit);
+    diypinball_switchMatrixScanner_setDebounceLimit(&switchMatrixScanner, 0, 5);
+
+    // tick and row read for each scan of switch 0, the reads at 11, 12 and 33 fall inside the debounce window
+    const uint32_t ticks[] = {10, 11, 12, 20, 30, 33, 38};
+    const uint8_t rows[] = {1, 0, 1, 0, 1, 0, 0};
+
+    {
+        InSequence dummy;
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testSwitchStateHandler(0, 1)).Times(1);
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testSwitchBounceHandler(0)).Times(2);
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testSwitchStateHandler(0, 0)).Times(1);
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testSwitchStateHandler(0, 1)).Times(1);
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testSwitchBounceHandler(0)).Times(1);
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testSwitchStateHandler(0, 0)).Times(1);
+    }
+
+    for(uint8_t i = 0; i < 7; i++) {
+        diypinball_switchMatrixScanner_millisecondTickHandler(&switchMatrixScanner, ticks[i]);
+        EXPECT_CALL(mySwitchMatrixScannerHandlers, testReadRowHandler(_)).Times(1).WillOnce(SetArgPointee<0>(rows[i]));
+        diypinball_switchMatrixScanner_isr(&switchMatrixScanner, INTERRUPT_MATCH_2);
+    }
+}
@@ -341,6 +341,23 @@ TEST_F(diypinball_systemManagementFeatureHandler_test, set_function_3_and_millis
     SysManHandlersImpl = NULL;
 }
 
+TEST_F(diypinball_systemManagementFeatureHandler_test, millisecond_tick_returns_ticks_until_next_poll)
+{
+    ASSERT_EQ(DIYPINBALL_TICK_NONE, diypinball_systemManagementFeatureHandler_millisecondTickHandler(&systemManagementFeatureHandler, 0));
+
+    systemManagementFeatureHandler.powerStatusPollingInterval = 10;
+
+    ASSERT_EQ(7, diypinball_systemManagementFeatureHandler_millisecondTickHandler(&systemManagementFeatureHandler, 3));
+
+    EXPECT_CALL(mySysManHandlers, testPowerStatusHandler(_, _)).Times(1);
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+
+    ASSERT_EQ(10, diypinball_systemManagementFeatureHandler_millisecondTickHandler(&systemManagementFeatureHandler, 12));
+
+    CANSendImpl = NULL;
+    SysManHandlersImpl = NULL;
+}
+
 TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_4_sends_serial_number_A_response)
 {
     diypinball_canMessage_t expectedCANMessage, initiatingCANMessage;
@@ -461,11 +478,218 @@ TEST_F(diypinball_systemManagementFeatureHandler_test, message_to_function_6_doe
     diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
 }
 
-TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_7_through_15_does_nothing)
+#if DIYPINBALL_FEATUREROUTER_STATISTICS
+static uint32_t testCycleCount;
+
+extern "C" {
+    static uint32_t testCycleCounterHandler(void) {
+        testCycleCount += 10;
+        return testCycleCount;
+    }
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_7_sends_feature_traffic_statistics)
+{
+    diypinball_canMessage_t expectedCANMessage, initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (12 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (6 << 4) | 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (7 << 4) | 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 3;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 1;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 1;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, feature_traffic_statistics_are_little_endian)
+{
+    diypinball_canMessage_t expectedCANMessage, initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (12 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    for(uint16_t i = 0; i < 0x0100; i++) {
+        diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+    }
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (7 << 4) | 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (7 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 0x01;
+    expectedCANMessage.data[1] = 0x01;
+    expectedCANMessage.data[2] = 0x00;
+    expectedCANMessage.data[3] = 0x00;
+    expectedCANMessage.data[4] = 0x00;
+    expectedCANMessage.data[5] = 0x00;
+    expectedCANMessage.data[6] = 0x00;
+    expectedCANMessage.data[7] = 0x01;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, message_to_function_7_clears_statistics)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+    diypinball_featureStatistics_t statistics;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (7 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 1;
+    initiatingCANMessage.data[0] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    diypinball_featureRouter_getStatistics(&router, 0, &statistics);
+    ASSERT_EQ(0, statistics.rxCount);
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_8_sends_feature_timing_statistics)
+{
+    diypinball_canMessage_t expectedCANMessage, initiatingCANMessage;
+
+    testCycleCount = 0;
+    diypinball_featureRouter_setCycleCounterHandler(&router, testCycleCounterHandler);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (6 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (8 << 4) | 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (8 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 8;
+    expectedCANMessage.data[0] = 10;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 10;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 10;
+    expectedCANMessage.data[5] = 0;
+    expectedCANMessage.data[6] = 1;
+    expectedCANMessage.data[7] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+#endif
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_9_sends_router_queue_statistics)
+{
+    diypinball_canMessage_t expectedCANMessage, initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (9 << 4) | 0;
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (9 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 6;
+    expectedCANMessage.data[0] = 2;
+    expectedCANMessage.data[1] = 0;
+    expectedCANMessage.data[2] = 0;
+    expectedCANMessage.data[3] = 0;
+    expectedCANMessage.data[4] = 0;
+    expectedCANMessage.data[5] = 0;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(2);
+
+    diypinball_featureRouter_enqueueCAN(&router, &initiatingCANMessage);
+    diypinball_featureRouter_enqueueCAN(&router, &initiatingCANMessage);
+    diypinball_featureRouter_processPending(&router);
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, setting_and_retrieving_function_10)
+{
+    diypinball_canMessage_t expectedCANMessage, initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (10 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 4;
+    initiatingCANMessage.data[0] = 0x05;
+    initiatingCANMessage.data[1] = 0x00;
+    initiatingCANMessage.data[2] = 0x00;
+    initiatingCANMessage.data[3] = 0x80;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(_)).Times(0);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0x80000005, diypinball_featureRouter_getGroupMask(&router));
+
+    ::testing::Mock::VerifyAndClearExpectations(&myCANSend);
+
+    initiatingCANMessage.rtr = 1;
+    initiatingCANMessage.dlc = 0;
+
+    expectedCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (10 << 4) | 0;
+    expectedCANMessage.rtr = 0;
+    expectedCANMessage.dlc = 4;
+    expectedCANMessage.data[0] = 0x05;
+    expectedCANMessage.data[1] = 0x00;
+    expectedCANMessage.data[2] = 0x00;
+    expectedCANMessage.data[3] = 0x80;
+
+    EXPECT_CALL(myCANSend, testCanSendHandler(CanMessageEqual(expectedCANMessage))).Times(1);
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, broadcast_to_function_10_does_not_change_groups)
+{
+    diypinball_canMessage_t initiatingCANMessage;
+
+    initiatingCANMessage.id = (0x00 << 25) | (0 << 24) | (0 << 16) | (0 << 12) | (0 << 8) | (10 << 4) | 0;
+    initiatingCANMessage.rtr = 0;
+    initiatingCANMessage.dlc = 4;
+    initiatingCANMessage.data[0] = 0xFF;
+    initiatingCANMessage.data[1] = 0xFF;
+    initiatingCANMessage.data[2] = 0xFF;
+    initiatingCANMessage.data[3] = 0xFF;
+
+    diypinball_featureRouter_receiveCAN(&router, &initiatingCANMessage);
+
+    ASSERT_EQ(0, diypinball_featureRouter_getGroupMask(&router));
+}
+
+TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_11_through_15_does_nothing)
 {
     diypinball_canMessage_t initiatingCANMessage;
 
-    for(uint8_t i = 7; i < 16; i++) {
+    for(uint8_t i = 11; i < 16; i++) {
         initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (i << 4) | 0;
         initiatingCANMessage.rtr = 1;
         initiatingCANMessage.dlc = 0;
@@ -477,11 +701,11 @@ TEST_F(diypinball_systemManagementFeatureHandler_test, request_to_function_7_thr
     }
 }
 
-TEST_F(diypinball_systemManagementFeatureHandler_test, message_to_function_7_through_15_does_nothing)
+TEST_F(diypinball_systemManagementFeatureHandler_test, message_to_function_8_through_15_does_nothing)
 {
     diypinball_canMessage_t initiatingCANMessage;
 
-    for(uint8_t i = 7; i < 16; i++) {
+    for(uint8_t i = 8; i < 16; i++) {
         initiatingCANMessage.id = (0x00 << 25) | (1 << 24) | (42 << 16) | (0 << 12) | (0 << 8) | (i << 4) | 0;
         initiatingCANMessage.rtr = 0;
         initiatingCANMessage.dlc = 1;